@@ -0,0 +1,118 @@
+#ifndef ACCUMULATION_BUFFER_H
+#define ACCUMULATION_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <vector>
+
+// Image units used by raytracer.cs, keep in sync with the layout() qualifiers there
+const GLuint HISTORY_IMAGE_UNIT = 1;
+const GLuint ACCUMULATION_IMAGE_UNIT = 2;
+const GLuint MOMENTS_HISTORY_IMAGE_UNIT = 5;
+const GLuint MOMENTS_IMAGE_UNIT = 6;
+
+// Ping-pong pair of accumulation textures. Each frame the compute pass reads the history
+// (previous frame) and writes the other texture, so no texel is ever bound read-write and
+// the resolve pass can sample last frame's result while the next one is being traced.
+// The running sum lives in .rgb and the number of accumulated frames in .a of an
+// RGBA32F texel (RGB32F is not a legal image load/store format), so the mean is never
+// re-normalized in place and the shader only needs a single load and a single store.
+// A second RG32F pair accumulates the first two moments of the (albedo demodulated)
+// luminance the same way; it is only touched while the denoiser is enabled.
+class AccumulationBuffer
+{
+public:
+    AccumulationBuffer(int width, int height)
+        : width(width), height(height), current(0)
+    {
+        for (int i = 0; i < 2; i++)
+        {
+            accumulationTex[i] = createTexture(GL_RGBA32F, GL_NEAREST);
+            momentsTex[i] = createTexture(GL_RG32F, GL_NEAREST);
+        }
+    }
+
+    ~AccumulationBuffer()
+    {
+        glDeleteTextures(2, accumulationTex);
+        glDeleteTextures(2, momentsTex);
+    }
+
+    AccumulationBuffer(const AccumulationBuffer&) = delete;
+    AccumulationBuffer& operator=(const AccumulationBuffer&) = delete;
+
+    // binds the image units for the next dispatch: history is read only, current is write only
+    void bindForDispatch() const
+    {
+        glBindImageTexture(HISTORY_IMAGE_UNIT, accumulationTex[1 - current], 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glBindImageTexture(ACCUMULATION_IMAGE_UNIT, accumulationTex[current], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+        glBindImageTexture(MOMENTS_HISTORY_IMAGE_UNIT, momentsTex[1 - current], 0, GL_FALSE, 0, GL_READ_ONLY, GL_RG32F);
+        glBindImageTexture(MOMENTS_IMAGE_UNIT, momentsTex[current], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG32F);
+    }
+
+    // call after the dispatch so the texture that was just written becomes next frame's history
+    void swap()
+    {
+        current = 1 - current;
+    }
+
+    // the most recently written accumulation texture (sum in .rgb, sample count in .a)
+    GLuint resultTexture() const
+    {
+        return accumulationTex[1 - current];
+    }
+
+    // the most recently written luminance moments (sum of l in .r, sum of l^2 in .g)
+    GLuint momentsTexture() const
+    {
+        return momentsTex[1 - current];
+    }
+
+    // Overwrites the most recent result, which the next dispatch reads as its history.
+    // moments may be null, they are cleared then.
+    void upload(const float* rgba, const float* moments)
+    {
+        std::vector<float> zeros;
+        if (!moments)
+        {
+            zeros.assign(size_t(width) * height * 2, 0.0f);
+            moments = zeros.data();
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindTexture(GL_TEXTURE_2D, resultTexture());
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_FLOAT, rgba);
+        glBindTexture(GL_TEXTURE_2D, momentsTexture());
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RG, GL_FLOAT, moments);
+    }
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+    // approximate bytes of image traffic the compute pass generates per pixel per frame
+    int bytesPerPixel() const
+    {
+        return 16 + 16;
+    }
+
+private:
+    int width;
+    int height;
+    int current;
+    GLuint accumulationTex[2];
+    GLuint momentsTex[2];
+
+    GLuint createTexture(GLenum internalFormat, GLint filter) const
+    {
+        GLuint tex;
+        glGenTextures(1, &tex);
+        glBindTexture(GL_TEXTURE_2D, tex);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+        glTexStorage2D(GL_TEXTURE_2D, 1, internalFormat, width, height);
+        return tex;
+    }
+};
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstdint>
+#include <future>
+#include <string>
+#include <vector>
+
+// Everything needed to continue an offline render: the accumulation texels and the frame
+// range, which is also the whole RNG state since raytracer.cs seeds every pixel from it.
+// The same file holds the partial results of sample range renders that --merge combines.
+struct Checkpoint
+{
+    int width = 0;
+    int height = 0;
+    int view = 0;                       // turntable view the state belongs to
+    uint32_t firstFrame = 0;            // frames rendered before this state's range
+    uint32_t frameCount = 0;
+    std::vector<float> accumulation;    // RGBA: sum in rgb, sample count in a
+    std::vector<float> moments;         // RG luminance moments, empty when the denoiser was off
+};
+
+// The file is a small header followed by the raw floats in native byte order. When every
+// pixel holds frameCount samples (no reprojection happened), the count channel is left out.
+// Saving goes through a temporary file that is renamed over the old checkpoint, so a job
+// killed mid-write still has the previous one.
+bool saveCheckpoint(const std::string& path, const Checkpoint& checkpoint);
+// headerOnly skips the pixel data
+bool loadCheckpoint(const std::string& path, Checkpoint& checkpoint, bool headerOnly = false);
+
+// Saves on a background thread, with at most one save in flight
+class CheckpointWriter
+{
+public:
+    CheckpointWriter() = default;
+    ~CheckpointWriter() { wait(); }
+
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    // waits for the previous save first
+    void save(const std::string& path, Checkpoint&& checkpoint);
+
+    // waits for the save in flight, false if any save failed so far
+    bool wait();
+
+    bool busy() const;
+
+private:
+    std::future<bool> pending;
+    bool ok = true;
+};
+
+#endif
@@ -4,57 +4,112 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <algorithm>
+#include <map>
 #include <string>
-#include <fstream>
-#include <sstream>
 #include <iostream>
 
+#include "ProgramCache.h"
+#include "ShaderPreprocessor.h"
+#include "ShaderReflection.h"
+
+// Preprocessor symbols a shader variant is compiled with, name -> value. Sorted, so equal
+// sets always produce the same source and the same program cache key.
+typedef std::map<std::string, std::string> ShaderDefines;
+
 class ComputeShader
 {
 public:
     unsigned int ID;
     // constructor generates the shader on the fly
     // ------------------------------------------------------------------------
-    ComputeShader(const char* computePath)
-    {
-        // 1. retrieve the vertex/fragment source code from filePath
-        std::string computeCode;
-        std::ifstream cShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        cShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        try
+    ComputeShader(const char* computePath, const ShaderDefines& defines = ShaderDefines())
+    {
+        // 1. retrieve the compute source code from filePath, with its #includes resolved
+        ShaderSource source = preprocessShader(computePath);
+        ID = compileProgram(injectDefines(source.code, defines), source.describeFiles());
+        reflection.reflect(ID);
+    }
+    // wraps a program built elsewhere, e.g. a variant from ShaderVariants
+    explicit ComputeShader(GLuint program) : ID(program)
+    {
+        reflection.reflect(ID);
+    }
+
+    // switches to another program (a variant or a reloaded one), handles stay valid
+    void setProgram(GLuint program)
+    {
+        if (program != ID)
         {
-            // open files
-            cShaderFile.open(computePath);
+            ID = program;
+            reflection.reflect(ID);
+        }
+    }
 
-            std::stringstream cShaderStream;
-            // read file's buffer contents into streams
-            cShaderStream << cShaderFile.rdbuf();
-            // close file handlers
-            cShaderFile.close();
-            // convert stream into string
-            computeCode = cShaderStream.str();
+    // 2. #defines go right after #version, which has to stay the first statement.
+    // A #line directive keeps compiler messages pointing at the lines of the file.
+    static std::string injectDefines(const std::string& source, const ShaderDefines& defines)
+    {
+        if (defines.empty())
+        {
+            return source;
         }
-        catch (std::ifstream::failure& e)
+        size_t version = source.find("#version");
+        size_t lineEnd = version == std::string::npos ? std::string::npos : source.find('\n', version);
+        if (lineEnd == std::string::npos)
         {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
+            std::cout << "ERROR::SHADER::NO_VERSION_DIRECTIVE, defines are not applied" << std::endl;
+            return source;
         }
+        int nextLine = 2 + (int)std::count(source.begin(), source.begin() + version, '\n');
+
+        std::string result = source.substr(0, lineEnd + 1);
+        for (const auto& define : defines)
+        {
+            result += "#define " + define.first + " " + define.second + "\n";
+        }
+        result += "#line " + std::to_string(nextLine) + "\n";
+        result += source.substr(lineEnd + 1);
+        return result;
+    }
+
+    // 3. compile, or reuse the binary of an earlier launch if the source and driver are unchanged.
+    // Returns 0 if the shader does not compile. fileNames (ShaderSource::describeFiles()) is
+    // printed with the errors, to tell which included file a message refers to.
+    static GLuint compileProgram(const std::string& computeCode, const std::string& fileNames = std::string())
+    {
         const char* cShaderCode = computeCode.c_str();
-        // 2. compile shaders
+        GLenum type = GL_COMPUTE_SHADER;
+        uint64_t cacheKey = programCacheKey(1, &type, &cShaderCode);
+        GLuint program = loadCachedProgram(cacheKey);
+        if (program)
+        {
+            return program;
+        }
         unsigned int compute;
         // compute shader
         compute = glCreateShader(GL_COMPUTE_SHADER);
         glShaderSource(compute, 1, &cShaderCode, NULL);
         glCompileShader(compute);
-        checkCompileErrors(compute, "COMPUTE");
+        if (!checkCompileErrors(compute, "COMPUTE"))
+        {
+            std::cout << fileNames;
+        }
 
         // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, compute);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
+        program = glCreateProgram();
+        glAttachShader(program, compute);
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(program);
         // delete the shaders as they're linked into our program now and no longer necessary
         glDeleteShader(compute);
+        if (!checkCompileErrors(program, "PROGRAM"))
+        {
+            glDeleteProgram(program);
+            return 0;
+        }
+        storeCachedProgram(cacheKey, program);
+        return program;
     }
     // activate the shader
     // ------------------------------------------------------------------------
@@ -62,69 +117,107 @@ public:
     {
         glUseProgram(ID);
     }
-    // utility uniform functions
+    // Handle of a uniform for the setters below, look it up once and keep it
+    UniformHandle uniformHandle(const char* name) { return reflection.handle(name); }
+
+    // utility uniform functions, by handle or (with a table lookup) by name
     // ------------------------------------------------------------------------
-    void setBool(const std::string& name, bool value) const
+    void setBool(UniformHandle uniform, bool value) const
+    {
+        glUniform1i(reflection.location(uniform), (int)value);
+    }
+    void setBool(const char* name, bool value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+        glUniform1i(reflection.uniformLocation(name), (int)value);
     }
     // ------------------------------------------------------------------------
-    void setInt(const std::string& name, int value) const
+    void setInt(UniformHandle uniform, int value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1i(reflection.location(uniform), value);
+    }
+    void setInt(const char* name, int value) const
+    {
+        glUniform1i(reflection.uniformLocation(name), value);
+    }
+    void setUInt(UniformHandle uniform, unsigned int value) const
+    {
+        glUniform1ui(reflection.location(uniform), value);
+    }
+    void setUInt(const char* name, unsigned int value) const
+    {
+        glUniform1ui(reflection.uniformLocation(name), value);
     }
     // ------------------------------------------------------------------------
-    void setFloat(const std::string& name, float value) const
+    void setFloat(UniformHandle uniform, float value) const
+    {
+        glUniform1f(reflection.location(uniform), value);
+    }
+    void setFloat(const char* name, float value) const
     {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1f(reflection.uniformLocation(name), value);
     }
     // ------------------------------------------------------------------------
-    void setVec2(const std::string& name, const glm::vec2& value) const
+    void setVec2(const char* name, const glm::vec2& value) const
+    {
+        glUniform2fv(reflection.uniformLocation(name), 1, &value[0]);
+    }
+    void setVec2(const char* name, float x, float y) const
     {
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform2f(reflection.uniformLocation(name), x, y);
     }
-    void setVec2(const std::string& name, float x, float y) const
+    void setIVec2(UniformHandle uniform, int x, int y) const
     {
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+        glUniform2i(reflection.location(uniform), x, y);
+    }
+    void setIVec2(const char* name, int x, int y) const
+    {
+        glUniform2i(reflection.uniformLocation(name), x, y);
     }
     // ------------------------------------------------------------------------
-    void setVec3(const std::string& name, const glm::vec3& value) const
+    void setVec3(const char* name, const glm::vec3& value) const
     {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform3fv(reflection.uniformLocation(name), 1, &value[0]);
     }
-    void setVec3(const std::string& name, float x, float y, float z) const
+    void setVec3(const char* name, float x, float y, float z) const
     {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+        glUniform3f(reflection.uniformLocation(name), x, y, z);
     }
     // ------------------------------------------------------------------------
-    void setVec4(const std::string& name, const glm::vec4& value) const
+    void setVec4(const char* name, const glm::vec4& value) const
     {
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform4fv(reflection.uniformLocation(name), 1, &value[0]);
     }
-    void setVec4(const std::string& name, float x, float y, float z, float w)
+    void setVec4(const char* name, float x, float y, float z, float w) const
     {
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+        glUniform4f(reflection.uniformLocation(name), x, y, z, w);
     }
     // ------------------------------------------------------------------------
-    void setMat2(const std::string& name, const glm::mat2& mat) const
+    void setMat2(const char* name, const glm::mat2& mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix2fv(reflection.uniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
-    void setMat3(const std::string& name, const glm::mat3& mat) const
+    void setMat3(const char* name, const glm::mat3& mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix3fv(reflection.uniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
-    void setMat4(const std::string& name, const glm::mat4& mat) const
+    void setMat4(UniformHandle uniform, const glm::mat4& mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix4fv(reflection.location(uniform), 1, GL_FALSE, &mat[0][0]);
     }
+    void setMat4(const char* name, const glm::mat4& mat) const
+    {
+        glUniformMatrix4fv(reflection.uniformLocation(name), 1, GL_FALSE, &mat[0][0]);
+    }
+
+    // uniforms and block bindings of the current program
+    ShaderReflection reflection;
 
 private:
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
-    void checkCompileErrors(GLuint shader, std::string type)
+    static bool checkCompileErrors(GLuint shader, std::string type)
     {
         GLint success;
         GLchar infoLog[1024];
@@ -146,6 +239,7 @@ private:
                 std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
             }
         }
+        return success;
     }
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+#include <vector>
+
+// Noisy colour and feature buffers of a render, all row major with the first row at the bottom
+// (the way they come back from glGetTexImage). Colour, albedo and normal are interleaved RGB/XYZ.
+struct CpuAovs
+{
+	int width = 0;
+	int height = 0;
+	std::vector<float> color;
+	std::vector<float> albedo;
+	std::vector<float> normal;
+	std::vector<float> depth;
+};
+
+struct CpuDenoiserSettings
+{
+	int iterations = 5;			// step sizes 1, 2, 4, ... 2^(iterations - 1)
+	float sigmaColor = 0.6f;	// halved every iteration
+	float sigmaNormal = 0.25f;
+	float sigmaDepth = 0.05f;	// relative to the center pixel's depth
+	float sigmaAlbedo = 0.1f;
+	int tileSize = 64;			// pixels per tile side, a tile and its apron should stay in L2
+	unsigned int threads = 0;	// 0 uses every hardware thread
+};
+
+// Edge-avoiding a-trous wavelet filter (Dammertz et al.) for machines without a GPU.
+// The colour is demodulated by albedo, filtered with a 5x5 B3 spline kernel whose taps are
+// weighted by colour, normal, depth and albedo similarity, then re-modulated.
+// Rows of 8 pixels are filtered with AVX2 when the CPU supports it, the image is split in
+// tiles that are distributed over a pool of worker threads.
+class CpuDenoiser
+{
+public:
+	explicit CpuDenoiser(const CpuDenoiserSettings &settings = CpuDenoiserSettings());
+
+	// writes interleaved RGB into output (resized to width * height * 3)
+	void denoise(const CpuAovs &aovs, std::vector<float> &output);
+
+	bool usesAvx2() const { return avx2; }
+
+private:
+	CpuDenoiserSettings settings;
+	bool avx2 = false;
+};
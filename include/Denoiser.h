@@ -0,0 +1,143 @@
+#ifndef DENOISER_H
+#define DENOISER_H
+
+#include <glad/glad.h>
+
+#include "ComputeShader.h"
+#include "ShaderVariants.h"
+#include "AccumulationBuffer.h"
+#include "GBuffer.h"
+
+// Image units used by svgf_variance.cs and svgf_atrous.cs
+const GLuint DENOISE_INPUT_IMAGE_UNIT = 1;
+const GLuint DENOISE_OUTPUT_IMAGE_UNIT = 2;
+
+struct DenoiserSettings
+{
+    bool enabled = true;
+    int iterations = 5;             // step sizes 1, 2, 4, ... 2^(iterations - 1)
+    float sigmaLuminance = 4.0f;
+    float sigmaNormal = 128.0f;
+    float sigmaDepth = 1.0f;
+};
+
+// Spatiotemporal variance-guided filter (SVGF). Temporal integration is the accumulation
+// (and reprojection) the tracer already does, so this only runs the variance estimate on the
+// accumulated moments and the edge-aware a-trous iterations. The result holds displayable
+// colour with a = 1 and can be fed to the resolve pass in place of the accumulation texture.
+class Denoiser
+{
+public:
+    Denoiser(int width, int height)
+        : width(width), height(height), shaderCompiler(nullptr),
+        varianceVariants(RESOURCES_PATH "svgf_variance.cs"),
+        atrousVariants(RESOURCES_PATH "svgf_atrous.cs"),
+        varianceShader(varianceVariants.select(ShaderDefines())),
+        atrousShader(atrousVariants.select(ShaderDefines()))
+    {
+        sigmaLuminanceUniform = atrousShader.uniformHandle("sigmaLuminance");
+        sigmaNormalUniform = atrousShader.uniformHandle("sigmaNormal");
+        sigmaDepthUniform = atrousShader.uniformHandle("sigmaDepth");
+        stepSizeUniform = atrousShader.uniformHandle("stepSize");
+        finalPassUniform = atrousShader.uniformHandle("finalPass");
+        allocate();
+    }
+
+    ~Denoiser()
+    {
+        glDeleteTextures(2, illuminationTex);
+    }
+
+    Denoiser(const Denoiser&) = delete;
+    Denoiser& operator=(const Denoiser&) = delete;
+
+    // reallocates the illumination textures, keeping the compiled shaders
+    void resize(int width, int height)
+    {
+        glDeleteTextures(2, illuminationTex);
+        this->width = width;
+        this->height = height;
+        allocate();
+    }
+
+    // Re-reads edited shaders, denoise() switches to them once they are compiled on compiler
+    void reloadShaders(ShaderCompiler* compiler)
+    {
+        shaderCompiler = compiler;
+        varianceVariants.reload();
+        atrousVariants.reload();
+    }
+
+    // Filters the most recent accumulation result, call after both buffers were swapped.
+    // Returns the texture holding the denoised image.
+    GLuint denoise(const AccumulationBuffer& accumulation, const GBuffer& gbuffer, const DenoiserSettings& settings)
+    {
+        varianceShader.setProgram(varianceVariants.select(ShaderDefines(), shaderCompiler));
+        atrousShader.setProgram(atrousVariants.select(ShaderDefines(), shaderCompiler));
+        glBindImageTexture(GBUFFER_IMAGE_UNIT, gbuffer.resultTexture(), 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32UI);
+
+        // Variance estimate and albedo demodulation
+        varianceShader.use();
+        glBindImageTexture(DENOISE_INPUT_IMAGE_UNIT, accumulation.resultTexture(), 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+        glBindImageTexture(MOMENTS_IMAGE_UNIT, accumulation.momentsTexture(), 0, GL_FALSE, 0, GL_READ_ONLY, GL_RG32F);
+        glBindImageTexture(DENOISE_OUTPUT_IMAGE_UNIT, illuminationTex[0], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+        glDispatchCompute((width + 15) / 16, (height + 15) / 16, 1);
+
+        // A-trous iterations, ping-ponging between the two illumination textures
+        atrousShader.use();
+        atrousShader.setFloat(sigmaLuminanceUniform, settings.sigmaLuminance);
+        atrousShader.setFloat(sigmaNormalUniform, settings.sigmaNormal);
+        atrousShader.setFloat(sigmaDepthUniform, settings.sigmaDepth);
+
+        int input = 0;
+        int iterations = settings.iterations > 0 ? settings.iterations : 1;
+        for (int i = 0; i < iterations; i++)
+        {
+            int stepSize = 1 << i;
+            glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+            atrousShader.setInt(stepSizeUniform, stepSize);
+            atrousShader.setBool(finalPassUniform, i == iterations - 1);
+            glBindImageTexture(DENOISE_INPUT_IMAGE_UNIT, illuminationTex[input], 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA16F);
+            glBindImageTexture(DENOISE_OUTPUT_IMAGE_UNIT, illuminationTex[1 - input], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+
+            // one work group per 16x16 lattice, stepSize^2 interleaved lattices per block
+            int blockSize = 16 * stepSize;
+            glDispatchCompute(((width + blockSize - 1) / blockSize) * stepSize,
+                ((height + blockSize - 1) / blockSize) * stepSize, 1);
+            input = 1 - input;
+        }
+
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+        return illuminationTex[input];
+    }
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+private:
+    void allocate()
+    {
+        for (int i = 0; i < 2; i++)
+        {
+            glGenTextures(1, &illuminationTex[i]);
+            glBindTexture(GL_TEXTURE_2D, illuminationTex[i]);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA16F, width, height);
+        }
+    }
+
+    int width;
+    int height;
+    ShaderCompiler* shaderCompiler;
+    ShaderVariants varianceVariants;
+    ShaderVariants atrousVariants;
+    ComputeShader varianceShader;
+    ComputeShader atrousShader;
+    UniformHandle sigmaLuminanceUniform, sigmaNormalUniform, sigmaDepthUniform, stepSizeUniform, finalPassUniform;
+    GLuint illuminationTex[2];
+};
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef DISTRIBUTED_H
+#define DISTRIBUTED_H
+
+#include <string>
+
+#include "Headless.h"
+
+// Spreads a headless render over several processes, possibly on several machines.
+// The coordinator splits the frame into tiles, or the samples into ranges of
+// options.jobFrames frames, and hands them to whichever worker asks next. Workers trace their tiles headless and send back the raw accumulation (sum and
+// sample count per pixel). The coordinator adds those into a full-frame buffer, so the
+// merge stays correctly weighted even when a tile of a lost worker is rendered again.
+// Only the coordinator needs to be given the render options, they travel with every job.
+
+// Serves options.tileSize (256 when unset) tiles or sample range jobs on address and writes options.output
+// once all of them came back. Returns the process exit code.
+int runCoordinator(const HeadlessOptions& options, const std::string& address);
+
+// Connects to a coordinator (retrying for a while, so workers may start first) and renders
+// jobs until it says there are none left. Returns the process exit code.
+int runWorker(const std::string& address);
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+#include <glad/glad.h>
+
+#include <vector>
+
+// Picks the render resolution scale that keeps the GPU frame time under a budget. Each frame
+// is bracketed by two GL_TIMESTAMP queries (they may overlap the profiler's GL_TIME_ELAPSED
+// ones) that are read a few frames later without waiting. Tracing cost grows with the pixel
+// count, so the next scale is scale * sqrt(budget / time). A new scale reallocates the render
+// targets and restarts the accumulation, so changes are quantized, need a settled measurement
+// and scaling up leaves headroom, to keep the scale from flickering.
+class DynamicResolution
+{
+public:
+    explicit DynamicResolution(double targetMilliseconds = 1000.0 / 60.0, int latency = 4);
+    ~DynamicResolution();
+
+    DynamicResolution(const DynamicResolution&) = delete;
+    DynamicResolution& operator=(const DynamicResolution&) = delete;
+
+    void setTarget(double milliseconds) { target = milliseconds; }
+    double getTarget() const { return target; }
+    // the scale stays within [minScale, maxScale] of the full resolution
+    void setRange(float minScale, float maxScale);
+
+    // Bracket the GPU work of a frame, endFrame() also updates the scale
+    void beginFrame();
+    void endFrame();
+
+    float getScale() const { return scale; }
+    // smoothed GPU frame time in milliseconds, 0 until the first measurement
+    double getGpuTime() const { return gpuTime; }
+
+private:
+    struct FrameQueries
+    {
+        GLuint begin = 0;
+        GLuint end = 0;
+        bool pending = false;
+        unsigned generation = 0;    // scale changes before the frame, older ones are dropped
+    };
+
+    void collect(FrameQueries& queries);
+    void update(double milliseconds);
+
+    double target;
+    float minScale;
+    float maxScale;
+    float scale;
+    double gpuTime;
+    int settledFrames;      // measurements since the last change
+    unsigned generation;
+    std::vector<FrameQueries> frames;
+    size_t head;
+};
+
+#endif
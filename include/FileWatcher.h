@@ -0,0 +1,28 @@
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <chrono>
+#include <string>
+
+// Tells when files in a directory were written, created, renamed or deleted, e.g. to reload
+// shaders after an edit. Uses inotify on Linux, which also catches editors that save by
+// renaming a new file over the old one. Elsewhere poll() just reports a possible change every
+// half second and the caller compares write times itself (ShaderSource::changed()).
+class FileWatcher
+{
+public:
+    explicit FileWatcher(const std::string& directory);
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // true if something changed since the last call, never blocks
+    bool poll();
+
+private:
+    int fd = -1;
+    std::chrono::steady_clock::time_point lastPoll;
+};
+
+#endif
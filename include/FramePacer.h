@@ -0,0 +1,66 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <deque>
+
+#include "Profiler.h"
+
+// Caps how many frames the CPU may queue ahead of the GPU, with a fence behind every frame,
+// instead of leaving it to the driver. One frame in flight gives the lowest input latency
+// (input is read once the previous frame is done, so the next one shows it right away),
+// two or three keep the GPU busy between frames for offline rendering.
+//
+// It also measures input latency: from inputSampled() until the GPU has executed the frame's
+// last command (the swap's blit), read from a GL_TIMESTAMP query behind it and converted to
+// CPU time. The display may scan out up to a refresh later; that part is not measured.
+class FramePacer
+{
+public:
+    explicit FramePacer(int maxFramesInFlight = 2);
+    ~FramePacer();
+
+    FramePacer(const FramePacer&) = delete;
+    FramePacer& operator=(const FramePacer&) = delete;
+
+    void setMaxFramesInFlight(int frames) { maxFramesInFlight = frames < 1 ? 1 : frames; }
+    int getMaxFramesInFlight() const { return maxFramesInFlight; }
+
+    // "pacing wait" and "input latency" are recorded as CPU sections, null turns that off
+    void setProfiler(Profiler* profiler) { this->profiler = profiler; }
+
+    // Start of a frame: retires finished frames and blocks while the maximum is in flight
+    void beginFrame();
+    // The frame's input was read, by default that is the end of beginFrame()
+    void inputSampled() { inputTime = std::chrono::steady_clock::now(); }
+    // After the frame's last command (the buffer swap, or the last dispatch offline)
+    void endFrame();
+    // Waits for every frame in flight, e.g. before reading results back
+    void finish();
+
+    // latest measurements in milliseconds, 0 until a frame has completed
+    double getLastLatency() const { return lastLatency; }
+    double getLastWait() const { return lastWait; }
+
+private:
+    struct Frame
+    {
+        GLsync fence;
+        GLuint timestamp;
+        std::chrono::steady_clock::time_point input;
+    };
+
+    // retires the oldest frame, waiting for it if wait is set; false if it is not done
+    bool retire(bool wait);
+
+    int maxFramesInFlight;
+    Profiler* profiler;
+    std::deque<Frame> inFlight;
+    std::chrono::steady_clock::time_point inputTime;
+    double lastLatency;
+    double lastWait;
+};
+
+#endif
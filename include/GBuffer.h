@@ -0,0 +1,84 @@
+#ifndef GBUFFER_H
+#define GBUFFER_H
+
+#include <glad/glad.h>
+
+// Image units used by raytracer.cs, reproject.cs and the svgf passes, keep in sync with the
+// layout() qualifiers there
+const GLuint GBUFFER_IMAGE_UNIT = 0;
+const GLuint CURRENT_SAMPLE_IMAGE_UNIT = 3;
+const GLuint PREV_GBUFFER_IMAGE_UNIT = 4;
+
+// Per-pixel data of the primary (pixel center) hit, written by raytracer.cs every frame.
+// Everything is packed into one RGBA32UI texel (see encode_gbuffer() in raytracer.cs):
+// octahedral normal, ray distance to the hit, screen space motion towards the previous frame
+// in pixels and albedo. The texture is ping-ponged so last frame's depth is available for
+// reprojection. The noisy colour of the current frame, which the reprojection pass needs for
+// its neighbourhood clamp, lives next to it.
+class GBuffer
+{
+public:
+    GBuffer(int width, int height)
+        : width(width), height(height), current(0)
+    {
+        currentSampleTex = createTexture(GL_RGBA16F);
+        for (int i = 0; i < 2; i++)
+        {
+            gbufferTex[i] = createTexture(GL_RGBA32UI);
+        }
+    }
+
+    ~GBuffer()
+    {
+        glDeleteTextures(1, &currentSampleTex);
+        glDeleteTextures(2, gbufferTex);
+    }
+
+    GBuffer(const GBuffer&) = delete;
+    GBuffer& operator=(const GBuffer&) = delete;
+
+    // raytracer.cs only writes these, the later passes only read them, so bind them read-write once
+    void bindForDispatch() const
+    {
+        glBindImageTexture(CURRENT_SAMPLE_IMAGE_UNIT, currentSampleTex, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA16F);
+        glBindImageTexture(GBUFFER_IMAGE_UNIT, gbufferTex[current], 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32UI);
+        glBindImageTexture(PREV_GBUFFER_IMAGE_UNIT, gbufferTex[1 - current], 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32UI);
+    }
+
+    // call after the dispatch so the G-buffer that was just written becomes next frame's previous one
+    void swap()
+    {
+        current = 1 - current;
+    }
+
+    // the most recently written G-buffer
+    GLuint resultTexture() const
+    {
+        return gbufferTex[1 - current];
+    }
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+private:
+    int width;
+    int height;
+    int current;
+    GLuint currentSampleTex;
+    GLuint gbufferTex[2];
+
+    GLuint createTexture(GLenum internalFormat) const
+    {
+        GLuint tex;
+        glGenTextures(1, &tex);
+        glBindTexture(GL_TEXTURE_2D, tex);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexStorage2D(GL_TEXTURE_2D, 1, internalFormat, width, height);
+        return tex;
+    }
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+#include "ImageIO.h"
+
+// Samples per pixel in one frame, the default RenderSettings::samplesPerFrame
+const int SAMPLES_PER_FRAME = 4;
+
+enum DenoiseMode { DENOISE_NONE, DENOISE_GPU, DENOISE_CPU };
+
+// Offline render settings, filled from the command line
+struct HeadlessOptions {
+    bool enabled = false;
+    int width = 1920;
+    int height = 1080;
+    int frames = 64;                // accumulation frames, SAMPLES_PER_FRAME per pixel each
+    int firstFrame = 0;             // frames of the render that come before this run's range
+    std::string output = "render.ppm";
+    ExrCompression exrCompression = EXR_ZIP_COMPRESSION;
+    int captureInterval = 0;        // also write every Nth frame as <output>_<frame>, 0 = off
+    int turntable = 0;              // views orbiting turntableCenter, written as <output>_<view>
+    glm::vec3 turntableCenter = glm::vec3(0.0f, 0.0f, -3.0f);
+    std::string checkpointPath;     // empty = no checkpoints
+    int checkpointInterval = 256;   // frames between checkpoints
+    bool resume = false;            // continue from checkpointPath if it matches this render
+    std::string partialPath;        // also save the raw accumulation, for --merge
+    std::vector<std::string> mergeInputs;
+    int tileSize = 0;               // render in tiles of this size, streamed to .ppm/.pfm/.exr
+
+    // distributed rendering, see Distributed.h
+    int jobFrames = 0;              // split the samples into jobs of this many frames instead of tiles
+    std::string coordinatorAddress;
+    std::string workerAddress;
+    DenoiseMode denoise = DENOISE_NONE;
+    float exposure = 1.0f;
+    bool profile = false;           // time every pass, headless prints the table at the end
+    bool rayStats = false;          // count rays and path depth in the trace pass
+    int framesInFlight = 0;         // frames queued ahead of the GPU, 0 = 1 interactive, 3 offline
+    int targetFps = 60;             // interactive dynamic resolution, 0 = fixed resolution
+
+    glm::vec3 cameraPosition = glm::vec3(0.0f, 0.0f, 3.0f);
+    float yaw = -90.0f;
+    float pitch = 0.0f;
+};
+
+// Returns false (after printing the usage) on unknown or malformed arguments
+bool parseCommandLine(int argc, char** argv, HeadlessOptions& options);
+
+// Writes a full-frame accumulation (RGBA: sum and sample count, rows bottom to top) to
+// options.output. 8-bit formats are tonemapped by the resolve pass, on a headless context.
+bool writeAccumulation(const HeadlessOptions& options, const std::vector<float>& rgba);
+
+// Adds up the partial renders in options.mergeInputs, in the order of their sample ranges,
+// and writes the result to options.output. Returns the process exit code.
+int runMerge(const HeadlessOptions& options);
+
+// Renders options.frames frames (per view) into a headless context and writes the result:
+// .exr and .pfm get the linear image, .png and .ppm the tonemapped sRGB resolve.
+// Returns the process exit code.
+int runHeadless(const HeadlessOptions& options);
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+// OpenGL 4.3 core context without a window, for offline rendering on servers and CI.
+// Uses an EGL surfaceless display when the build found EGL (Mesa's llvmpipe works), and
+// falls back to an invisible GLFW window otherwise. Rendering goes to our own FBOs, so
+// no default framebuffer is needed.
+class HeadlessContext
+{
+public:
+    HeadlessContext() = default;
+    ~HeadlessContext() { destroy(); }
+
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    // creates the context, makes it current and loads the GL functions
+    bool create();
+    void destroy();
+
+private:
+    void* display = nullptr;    // EGLDisplay
+    void* context = nullptr;    // EGLContext or GLFWwindow*
+};
+
+#endif
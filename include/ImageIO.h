@@ -0,0 +1,30 @@
+#ifndef IMAGE_IO_H
+#define IMAGE_IO_H
+
+#include <string>
+#include <vector>
+
+// Minimal writers for the offline renderer. All of them take rows bottom to top, the order
+// glGetTexImage returns them in.
+
+// Portable float map: linear, unclamped RGB (PFM itself is stored bottom to top)
+bool writePFM(const std::string& path, int width, int height, const std::vector<float>& rgb);
+
+// Binary PPM from 8-bit RGBA (alpha is dropped), rows are flipped to top to bottom
+bool writePPM(const std::string& path, int width, int height, const std::vector<unsigned char>& rgba);
+
+// 8-bit PNG through stb_image_write, alpha is kept
+bool writePNG(const std::string& path, int width, int height, const std::vector<unsigned char>& rgba);
+
+enum ExrCompression { EXR_NO_COMPRESSION = 0, EXR_ZIP_COMPRESSION = 3 };
+
+// Header of a scanline OpenEXR file with half float B, G, R channels, up to (not including)
+// the block offset table
+std::vector<unsigned char> exrHeader(int width, int height, ExrCompression compression);
+
+// Scanline OpenEXR with half float R, G and B channels, either uncompressed or ZIP
+// (16 line blocks, deflated with stb_image_write's zlib encoder, see stb_zlib_compress.h)
+bool writeEXR(const std::string& path, int width, int height, const std::vector<float>& rgb,
+    ExrCompression compression = EXR_ZIP_COMPRESSION);
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef IMAGE_WRITER_H
+#define IMAGE_WRITER_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ImageIO.h"
+
+// One finished frame waiting to be encoded. Depending on the extension of path the writer
+// uses rgba8 (.png, .ppm: the tonemapped sRGB resolve) or rgb (.exr, .pfm: linear colour).
+struct ImageJob
+{
+    std::string path;
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> rgba8;
+    std::vector<float> rgb;
+};
+
+struct ImageWriterSettings
+{
+    unsigned int threads = 0;       // 0 uses half the hardware threads, the CPU denoiser wants the rest
+    size_t queueCapacity = 4;       // jobs waiting to be encoded, submit() blocks beyond that
+    ExrCompression exrCompression = EXR_ZIP_COMPRESSION;
+};
+
+// Encodes and writes images on a pool of worker threads so the render thread only pays for
+// handing the pixels over. The queue is bounded: when encoding falls behind, submit() blocks
+// until a worker takes a job, which keeps memory flat on long sequences.
+class ImageWriter
+{
+public:
+    explicit ImageWriter(const ImageWriterSettings& settings = ImageWriterSettings());
+    // finishes every queued job
+    ~ImageWriter();
+
+    ImageWriter(const ImageWriter&) = delete;
+    ImageWriter& operator=(const ImageWriter&) = delete;
+
+    void submit(ImageJob&& job);
+
+    // waits until every submitted job has been written
+    void flush();
+
+    int getFailures() const;
+
+private:
+    void workerLoop();
+    bool encode(const ImageJob& job) const;
+
+    ImageWriterSettings settings;
+    std::vector<std::thread> workers;
+
+    mutable std::mutex mutex;
+    std::condition_variable jobAvailable;
+    std::condition_variable slotAvailable;
+    std::condition_variable drained;
+    std::deque<ImageJob> queue;
+    int busyWorkers = 0;
+    int failures = 0;
+    bool stopping = false;
+};
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef OVERLAY_H
+#define OVERLAY_H
+
+#include <deque>
+#include <vector>
+
+#include "Renderer.h"
+#include "Profiler.h"
+#include "RayStats.h"
+#include "FramePacer.h"
+
+struct GLFWwindow;
+
+// ImGui window on top of the interactive view: per-pass timings with frame time graphs,
+// ray throughput, sample and frame counts, memory use, and the render settings that can be
+// changed live. Settings that invalidate the accumulated image reset it.
+class Overlay
+{
+public:
+    // installs ImGui's GLFW callbacks, chaining the ones already set on window
+    explicit Overlay(GLFWwindow* window);
+    ~Overlay();
+
+    Overlay(const Overlay&) = delete;
+    Overlay& operator=(const Overlay&) = delete;
+
+    // Builds and draws the overlay on the default framebuffer, call after present()
+    void draw(Renderer& renderer, const Profiler& profiler, const FrameRayStats& rayStats, FramePacer& pacer);
+
+    // off while the mouse steers the camera, so the hidden cursor does not click widgets
+    void setMouseEnabled(bool enabled);
+
+    bool visible = true;
+    // of the window size, applied by resizing the renderer; the upper limit while the scale
+    // is dynamic, which holds the frame time of targetFps
+    float resolutionScale = 1.0f;
+    bool dynamicResolution = true;
+    int targetFps = 60;
+
+private:
+    void plot(const char* label, const std::vector<float>& samples, const char* unit);
+
+    std::vector<float> history;
+    std::deque<float> mraysHistory;
+    bool hasMemoryInfo = false;
+};
+
+#endif
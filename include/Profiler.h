@@ -0,0 +1,140 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Rolling statistics of one timed section, all times in milliseconds
+struct ProfileStats
+{
+    std::string name;
+    bool gpu = false;
+    size_t samples = 0;     // in the window the numbers below cover
+    double last = 0.0;
+    double average = 0.0;
+    double p50 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+};
+
+// Per-pass timings of the frame loop. GPU sections are wrapped in GL_TIME_ELAPSED queries
+// that are collected latency frames later, by then the GPU has long finished them and
+// reading the result never stalls the pipeline. A result that is still not available is
+// dropped rather than waited for. CPU sections are plain steady_clock intervals.
+// Every section keeps its last window samples for averages and percentiles.
+// GL time queries cannot nest, so GPU sections must not overlap each other.
+class Profiler
+{
+public:
+    explicit Profiler(int latency = 4, size_t window = 256);
+    ~Profiler();
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    // Brackets one frame; beginFrame() collects the queries issued latency frames ago
+    void beginFrame();
+    void endFrame();
+
+    void beginGpu(const char* name);
+    void endGpu();
+
+    void addCpu(const char* name, double milliseconds);
+
+    // every section seen so far, in the order they were first recorded
+    std::vector<ProfileStats> getStats() const;
+    void print(std::ostream& out) const;
+
+    // window of samples of one section, oldest first; empty if it was never recorded
+    void getHistory(const char* name, bool gpu, std::vector<float>& samples) const;
+
+    uint64_t getFrame() const { return frame; }
+    uint64_t getDroppedQueries() const { return dropped; }
+
+private:
+    struct Section
+    {
+        Section(const char* name, bool gpu) : name(name), gpu(gpu) {}
+
+        std::string name;
+        bool gpu;
+        std::vector<float> samples;     // ring of the last window samples
+        size_t next = 0;
+        double last = 0.0;
+    };
+
+    struct PendingQuery
+    {
+        GLuint query;
+        size_t section;
+    };
+
+    // queries issued during one frame, recycled every latency frames
+    struct FrameQueries
+    {
+        std::vector<GLuint> pool;
+        std::vector<PendingQuery> pending;
+    };
+
+    size_t findSection(const char* name, bool gpu);
+    void record(size_t section, double milliseconds);
+    void collect(FrameQueries& queries);
+
+    size_t window;
+    std::vector<Section> sections;
+    std::vector<FrameQueries> frames;
+    uint64_t frame;
+    uint64_t dropped;
+    bool gpuActive;
+};
+
+// Times a GPU pass until the end of the scope, a null profiler makes it a no-op
+class ScopedGpuTimer
+{
+public:
+    ScopedGpuTimer(Profiler* profiler, const char* name) : profiler(profiler)
+    {
+        if (profiler) profiler->beginGpu(name);
+    }
+    ~ScopedGpuTimer()
+    {
+        if (profiler) profiler->endGpu();
+    }
+
+    ScopedGpuTimer(const ScopedGpuTimer&) = delete;
+    ScopedGpuTimer& operator=(const ScopedGpuTimer&) = delete;
+
+private:
+    Profiler* profiler;
+};
+
+// CPU time until the end of the scope
+class ScopedCpuTimer
+{
+public:
+    ScopedCpuTimer(Profiler* profiler, const char* name)
+        : profiler(profiler), name(name), start(std::chrono::steady_clock::now()) {}
+    ~ScopedCpuTimer()
+    {
+        if (profiler) {
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            profiler->addCpu(name, elapsed.count());
+        }
+    }
+
+    ScopedCpuTimer(const ScopedCpuTimer&) = delete;
+    ScopedCpuTimer& operator=(const ScopedCpuTimer&) = delete;
+
+private:
+    Profiler* profiler;
+    const char* name;
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif
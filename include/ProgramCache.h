@@ -0,0 +1,30 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+
+// On-disk cache of linked program binaries (glGetProgramBinary / glProgramBinary), so a launch
+// only compiles GLSL that changed since the last one. Entries are keyed by a hash of every
+// stage's final source together with the GL vendor, renderer and version strings, so a driver
+// update never even sees a stale binary. A binary the driver still refuses is deleted and the
+// caller compiles from source as if it had missed. The least recently used entries are
+// deleted once the directory holds more than 64 MB of them.
+
+// Defaults to $RAYTRACER_SHADER_CACHE, else <user cache dir>/raytracer/shaders.
+// An empty directory (or RAYTRACER_SHADER_CACHE=off) disables the cache.
+void setProgramCacheDirectory(const std::string& directory);
+std::string getProgramCacheDirectory();
+
+// Key of a program built from count stages, needs a current context for the driver strings
+uint64_t programCacheKey(int count, const GLenum* types, const char* const* sources);
+
+// Returns a linked program, or 0 if there is no usable entry
+GLuint loadCachedProgram(uint64_t key);
+
+// Saves a linked program. Link it with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+void storeCachedProgram(uint64_t key, GLuint program);
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef RAY_STATS_H
+#define RAY_STATS_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <vector>
+
+// Shader storage binding of RayStatsBuffer in raytracer.cs
+const GLuint RAY_STATS_BINDING = 0;
+
+// Matches RayStatsBuffer (std430)
+struct RayCounters
+{
+    GLuint rays;            // scene intersection queries, camera and G-buffer rays included
+    GLuint bounces;         // scatter events that continued a path
+    GLuint terminations;    // paths ended early: absorbed or below the throughput cutoff
+    GLuint primitiveTests;  // ray-sphere tests; the scene has no acceleration structure to visit
+    GLuint paths;           // camera samples traced
+};
+
+struct FrameRayStats
+{
+    uint64_t frame = 0;
+    RayCounters counters = {};
+    double gpuSeconds = 0.0;    // of the trace dispatch
+
+    double mraysPerSecond() const { return gpuSeconds > 0.0 ? counters.rays / gpuSeconds * 1e-6 : 0.0; }
+    double averagePathDepth() const { return counters.paths ? double(counters.bounces) / counters.paths : 0.0; }
+};
+
+// Collects the counters raytracer.cs gathers while collectStats is set. Every traced frame gets
+// a small buffer of its own from a ring, zeroed on the GPU, and a pair of timestamps around the
+// dispatch. read() only looks at slots whose fence has signalled, so the counters of frame N
+// arrive a few frames later and the CPU never waits on them. When every slot is still in flight
+// begin() refuses and that frame simply goes uncounted.
+class RayStatsRing
+{
+public:
+    explicit RayStatsRing(int depth = 4) : slots(depth), head(0), pending(0)
+    {
+        for (Slot& slot : slots)
+        {
+            glGenBuffers(1, &slot.buffer);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, slot.buffer);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(RayCounters), nullptr, GL_DYNAMIC_READ);
+            glGenQueries(2, slot.timestamps);
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    ~RayStatsRing()
+    {
+        for (Slot& slot : slots)
+        {
+            if (slot.fence) glDeleteSync(slot.fence);
+            glDeleteBuffers(1, &slot.buffer);
+            glDeleteQueries(2, slot.timestamps);
+        }
+    }
+
+    RayStatsRing(const RayStatsRing&) = delete;
+    RayStatsRing& operator=(const RayStatsRing&) = delete;
+
+    // Binds cleared counters for the next dispatch, false if every slot is still in flight
+    bool begin(uint64_t frame)
+    {
+        if (pending == (int)slots.size()) return false;
+
+        Slot& slot = slots[head];
+        GLuint zero = 0;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, slot.buffer);
+        glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, RAY_STATS_BINDING, slot.buffer);
+        glQueryCounter(slot.timestamps[0], GL_TIMESTAMP);
+        slot.frame = frame;
+        return true;
+    }
+
+    // call after the dispatch begin() returned true for
+    void end()
+    {
+        Slot& slot = slots[head];
+        glQueryCounter(slot.timestamps[1], GL_TIMESTAMP);
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        head = (head + 1) % slots.size();
+        pending++;
+    }
+
+    // Takes the oldest finished frame's counters, false if none is ready yet
+    bool read(FrameRayStats& stats)
+    {
+        if (pending == 0) return false;
+
+        Slot& slot = slots[(head + slots.size() - pending) % slots.size()];
+        GLenum result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) return false;
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, slot.buffer);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(RayCounters), &stats.counters);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        GLuint64 start = 0, stop = 0;
+        glGetQueryObjectui64v(slot.timestamps[0], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(slot.timestamps[1], GL_QUERY_RESULT, &stop);
+        stats.gpuSeconds = stop > start ? double(stop - start) * 1e-9 : 0.0;
+        stats.frame = slot.frame;
+        pending--;
+        return true;
+    }
+
+private:
+    struct Slot
+    {
+        GLuint buffer = 0;
+        GLuint timestamps[2] = {};
+        GLsync fence = nullptr;
+        uint64_t frame = 0;
+    };
+
+    std::vector<Slot> slots;
+    size_t head;    // next slot to count into
+    int pending;    // counted but not read yet, the oldest is head - pending
+};
+
+#endif
@@ -0,0 +1,148 @@
+#ifndef READBACK_RING_H
+#define READBACK_RING_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Outcome of ReadbackRing::read()
+enum ReadbackResult
+{
+    READBACK_NOT_READY,     // nothing requested, or the oldest copy is still in flight
+    READBACK_OK,            // the oldest readback was copied out and its slot freed
+    READBACK_FAILED         // its slot was freed, but the fence or the mapping failed
+};
+
+// Asynchronous texture readback through a ring of pixel pack buffers. request() only queues
+// a glGetTexImage into the next PBO and drops a fence behind it, the copy runs on the GPU
+// while the following frames are traced. read() maps the oldest PBO once its fence has
+// signalled, so with a ring of 3-4 buffers frame N is copied out while N+1..N+3 render
+// and the render thread never waits on the pipeline to drain.
+class ReadbackRing
+{
+public:
+    // format/type are the glGetTexImage client format, e.g. GL_RGBA + GL_FLOAT
+    ReadbackRing(int width, int height, GLenum format, GLenum type, int bytesPerPixel, int depth = 4)
+        : width(width), height(height), format(format), type(type),
+        size(size_t(width) * height * bytesPerPixel), slots(depth), head(0), pending(0)
+    {
+        for (Slot& slot : slots)
+        {
+            glGenBuffers(1, &slot.pbo);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+            glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    ~ReadbackRing()
+    {
+        for (Slot& slot : slots)
+        {
+            if (slot.fence) glDeleteSync(slot.fence);
+            glDeleteBuffers(1, &slot.pbo);
+        }
+    }
+
+    ReadbackRing(const ReadbackRing&) = delete;
+    ReadbackRing& operator=(const ReadbackRing&) = delete;
+
+    // Queues a copy of the texture's level 0, tagged with frame. Returns false when every
+    // buffer is still waiting to be read, read() (with wait = true if need be) frees one.
+    bool request(GLuint texture, uint64_t frame)
+    {
+        if (full()) return false;
+
+        Slot& slot = slots[head];
+        // the textures are written with imageStore, which texture and PBO reads do not see without it
+        glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT | GL_PIXEL_BUFFER_BARRIER_BIT);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glGetTexImage(GL_TEXTURE_2D, 0, format, type, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.frame = frame;
+
+        head = (head + 1) % slots.size();
+        pending++;
+        return true;
+    }
+
+    // Copies the oldest finished readback into pixels (size() bytes). Without wait it returns
+    // READBACK_NOT_READY right away if the GPU is not done with it yet. Any other result
+    // retires the oldest request, so callers keeping a queue in request order pop it for both.
+    ReadbackResult read(void* pixels, uint64_t& frame, bool wait = false)
+    {
+        if (pending == 0) return READBACK_NOT_READY;
+
+        Slot& slot = slots[(head + slots.size() - pending) % slots.size()];
+        GLuint64 timeout = wait ? 1000000000ull : 0;
+        bool signalled = false;
+        for (;;)
+        {
+            GLenum result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+            if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED)
+            {
+                signalled = true;
+                break;
+            }
+            if (result == GL_WAIT_FAILED) break;
+            if (!wait) return READBACK_NOT_READY;
+        }
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+
+        const void* mapped = nullptr;
+        if (signalled)
+        {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+            mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+            if (mapped)
+            {
+                std::memcpy(pixels, mapped, size);
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            }
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+
+        frame = slot.frame;
+        pending--;
+        return mapped ? READBACK_OK : READBACK_FAILED;
+    }
+
+    ReadbackResult read(std::vector<unsigned char>& pixels, uint64_t& frame, bool wait = false)
+    {
+        if (pending == 0) return READBACK_NOT_READY;
+        pixels.resize(size);
+        return read(pixels.data(), frame, wait);
+    }
+
+    // bytes of one readback
+    size_t getSize() const { return size; }
+    bool full() const { return pending == (int)slots.size(); }
+    bool empty() const { return pending == 0; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+private:
+    struct Slot
+    {
+        GLuint pbo = 0;
+        GLsync fence = nullptr;
+        uint64_t frame = 0;
+    };
+
+    int width;
+    int height;
+    GLenum format;
+    GLenum type;
+    size_t size;
+    std::vector<Slot> slots;
+    size_t head;    // next slot to request into
+    int pending;    // requested but not read yet, the oldest is head - pending
+};
+
+#endif
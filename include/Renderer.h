@@ -0,0 +1,209 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <vector>
+
+#include "Camera.h"
+#include "ComputeShader.h"
+#include "ShaderVariants.h"
+#include "demoShaderLoader.h"
+#include "AccumulationBuffer.h"
+#include "ResolveTarget.h"
+#include "GBuffer.h"
+#include "Denoiser.h"
+#include "CpuDenoiser.h"
+#include "Profiler.h"
+#include "RayStats.h"
+#include "UniformRing.h"
+#include "SampleBudget.h"
+
+// Camera data structure matching std140 layout
+struct CameraFrame {
+    glm::vec4 position;
+    glm::vec4 front;
+    glm::vec4 up;
+    glm::vec4 right;
+    glm::vec2 fovAndAspect;
+    glm::vec2 padding;
+};
+
+// Current and previous frame's camera, the previous one is used for reprojection
+struct CameraData {
+    CameraFrame current;
+    CameraFrame previous;
+};
+
+// Matches AccumulationBlock (std140)
+struct AccumulationData {
+    GLuint frameCount;
+    GLuint reprojectHistory;
+    GLuint maxHistoryFrames;
+    GLuint accumulateMoments;
+};
+
+struct RenderSettings {
+    // Tracing, compiled into the trace shader (see traceDefines()). The renderer switches
+    // variants and resets the accumulation by itself. Headless sample ranges
+    // (SAMPLES_PER_FRAME in Headless.h) assume the default samplesPerFrame.
+    int samplesPerFrame = 4;
+    int maxBounces = 100;
+    // leave the metal or glass sphere out of the scene
+    bool sceneHasMetal = true;
+    bool sceneHasGlass = true;
+    // fewer samples away from a region of interest, the region moves without a reset
+    RegionOfInterest regionOfInterest;
+
+    // Temporal reprojection, when disabled any camera movement resets the accumulation
+    bool temporalReprojection = true;
+    GLuint maxHistoryFrames = 32;
+
+    DenoiserSettings denoiser;
+
+    // Count rays, bounces and intersection tests in the trace pass, see readRayStats()
+    bool collectRayStats = false;
+
+    // Display
+    float exposure = 1.0f;
+    ToneMapOperator toneMapOperator = TONEMAP_ACES;
+};
+
+// Owns every GPU resource of the path tracer and runs the per-frame passes:
+// trace (raytracer.cs), reproject, denoise and resolve. The window (or the headless
+// context) only has to feed it the camera and present the resolve target.
+class Renderer
+{
+public:
+    Renderer(int width, int height);
+    ~Renderer();
+
+    Renderer(const Renderer&) = delete;
+    Renderer& operator=(const Renderer&) = delete;
+
+    // call once per frame before render(), keeps last frame's camera for reprojection
+    void setCamera(const Camera& camera);
+
+    // traces one frame; cameraMoved reprojects (or resets) the accumulated history
+    void render(bool cameraMoved);
+
+    // tonemaps the latest frame into the sRGB resolve target
+    void resolve() { resolve(displayTexture); }
+    // same for an external image holding (sum, count) or (colour, 1) texels
+    void resolve(GLuint sourceTexture);
+
+    // blits the resolve target to the default framebuffer, bilinearly upsampled if it is smaller
+    void present(int screenWidth, int screenHeight);
+
+    void resetAccumulation();
+
+    // Reallocates the render targets for whole width x height frames, dropping any tile.
+    // Does nothing for the current size. The targets are immutable (glTexStorage2D), so a
+    // new size replaces them; shaders stay compiled and the accumulation starts over.
+    void resize(int width, int height);
+
+    // Continues accumulating on top of a saved state (see Checkpoint.h), frameCount is the
+    // number of frames it holds. moments may be empty.
+    void restoreAccumulation(GLuint frameCount, const std::vector<float>& rgba, const std::vector<float>& moments);
+
+    // Renders only the width x height tile at (x, y) of an imageWidth x imageHeight frame.
+    // The renderer's textures stay tile sized, changing the tile resets the accumulation.
+    void setTile(int x, int y, int imageWidth, int imageHeight);
+
+    // Number of frames rendered before this run, the accumulation then holds frames
+    // frameOffset + 1 ... frameOffset + frameCount of the render. See frameIndex in raytracer.cs.
+    void setFrameOffset(GLuint offset) { frameOffset = offset; }
+
+    // Readbacks, rows bottom to top
+    void readResolved(std::vector<unsigned char>& rgba);
+    void readDisplay(std::vector<float>& rgb);
+    // raw RGBA accumulation, sum and sample count
+    void readAccumulation(std::vector<float>& rgba);
+    void readAovs(CpuAovs& aovs);
+
+    // latest frame as (sum, count) or (colour, 1), and its tonemapped sRGB resolve
+    GLuint getDisplayTexture() const { return displayTexture; }
+    GLuint getResolvedTexture() const { return resolveTarget->getTexture(); }
+    // raw accumulation state of the latest frame, for checkpoints
+    GLuint getAccumulationTexture() const { return accumulation->resultTexture(); }
+    GLuint getMomentsTexture() const { return accumulation->momentsTexture(); }
+
+    // RGBA texels of either display texture layout to RGB means
+    static void averageSamples(const float* rgba, size_t pixelCount, std::vector<float>& rgb);
+
+    // Counters of the oldest traced frame whose stats have arrived and were not read yet.
+    // Call until it returns false, undrained results stop the collection.
+    bool readRayStats(FrameRayStats& stats) { return rayStats && rayStats->read(stats); }
+
+    // times every pass into profiler from now on, null turns it off
+    void setProfiler(Profiler* profiler) { this->profiler = profiler; }
+
+    // Compiles trace shader variants for changed settings in the background, tracing goes on
+    // with the previous variant until the new one is ready. Null compiles them on the spot.
+    void setShaderCompiler(ShaderCompiler* compiler) { shaderCompiler = compiler; }
+
+    // Re-reads compute shaders whose files changed (see FileWatcher) and recompiles them with
+    // the shader compiler. Each pass switches at the start of a frame once its new program is
+    // ready and keeps the old one if it does not compile. Only a new trace kernel resets the
+    // accumulation.
+    void reloadShaders();
+
+    // raytracer.cs defines for the current settings
+    ShaderDefines traceDefines() const;
+
+    GLuint getFrameCount() const { return accumulationData.frameCount; }
+    // bytes of every texture the renderer allocated
+    size_t getTextureMemory() const;
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+    RenderSettings settings;
+
+private:
+    // makes the compute passes' imageStore writes visible to glGetTexImage
+    static void readbackBarrier() { glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT); }
+    // reads what render() needs per frame out of activeDefines, once per variant switch
+    void cacheActiveDefines();
+
+    int width;
+    int height;
+    glm::ivec2 tileOffset;
+    glm::ivec2 imageResolution;
+    GLuint frameOffset;
+    Profiler* profiler;
+    ShaderCompiler* shaderCompiler;
+
+    // every trace variant compiled so far, computeShader wraps the one in use
+    ShaderVariants traceVariants;
+    ShaderDefines activeDefines;
+    unsigned activeGeneration;
+    int activeBudgetSamples;    // SAMPLES of a SAMPLE_BUDGET variant, 0 without a budget
+    bool activeCountsRays;      // RAY_STATS
+    ComputeShader computeShader;
+    ShaderVariants reprojectVariants;
+    ComputeShader reprojectShader;
+    Shader quadShader;
+    UniformHandle tileOffsetUniform, imageResolutionUniform, frameIndexUniform, collectStatsUniform;
+    UniformHandle exposureUniform, tonemapOperatorUniform;
+    GLuint quadVAO, quadVBO;
+    std::unique_ptr<UniformRing> frameUniforms;
+    GLint cameraBinding;
+    GLint accumulationBinding;
+
+    std::unique_ptr<AccumulationBuffer> accumulation;
+    std::unique_ptr<ResolveTarget> resolveTarget;
+    std::unique_ptr<GBuffer> gbuffer;
+    std::unique_ptr<Denoiser> denoiser;
+    std::unique_ptr<RayStatsRing> rayStats;
+    std::unique_ptr<SampleBudget> sampleBudget;
+
+    CameraData cameraData;
+    AccumulationData accumulationData;
+    bool firstFrame;
+    bool shouldResetAccumulation;
+    GLuint displayTexture;
+};
+
+#endif
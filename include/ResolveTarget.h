@@ -0,0 +1,82 @@
+#ifndef RESOLVE_TARGET_H
+#define RESOLVE_TARGET_H
+
+#include <glad/glad.h>
+
+// Tonemapping operators understood by the resolve pass (frag.frag)
+enum ToneMapOperator {
+    TONEMAP_NONE = 0,
+    TONEMAP_ACES = 1,
+    TONEMAP_FILMIC = 2
+};
+
+// RGBA8 sRGB render target the resolve pass draws into. The accumulation buffer is divided,
+// exposed and tonemapped once per frame into this texture, and presenting is a plain blit
+// that reads 4 bytes per pixel instead of the 16 of the RGBA32F accumulation.
+class ResolveTarget
+{
+public:
+    ResolveTarget(int width, int height)
+        : width(width), height(height)
+    {
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_SRGB8_ALPHA8, width, height);
+
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    ~ResolveTarget()
+    {
+        glDeleteFramebuffers(1, &FBO);
+        glDeleteTextures(1, &texture);
+    }
+
+    ResolveTarget(const ResolveTarget&) = delete;
+    ResolveTarget& operator=(const ResolveTarget&) = delete;
+
+    // binds the target for the resolve draw, linear shader output is encoded to sRGB on write
+    void begin() const
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glViewport(0, 0, width, height);
+        glEnable(GL_FRAMEBUFFER_SRGB);
+    }
+
+    void end() const
+    {
+        glDisable(GL_FRAMEBUFFER_SRGB);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    // copies the already encoded bytes to the default framebuffer; with GL_FRAMEBUFFER_SRGB
+    // disabled the blit performs no conversion
+    void blitToScreen(int screenWidth, int screenHeight) const
+    {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, screenWidth, screenHeight, GL_COLOR_BUFFER_BIT,
+            (screenWidth == width && screenHeight == height) ? GL_NEAREST : GL_LINEAR);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    GLuint getTexture() const { return texture; }
+    GLuint getFramebuffer() const { return FBO; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+private:
+    int width;
+    int height;
+    GLuint texture;
+    GLuint FBO;
+};
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef SAMPLE_BUDGET_H
+#define SAMPLE_BUDGET_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <vector>
+
+// Shader storage binding of SampleBudgetBuffer in raytracer.cs
+const GLuint SAMPLE_BUDGET_BINDING = 1;
+// pixels along each side of a budget tile, one raytracer.cs work group
+const int SAMPLE_BUDGET_TILE = 16;
+
+// Foveated sampling for look development: tiles around the region of interest trace every
+// sample of the frame, the periphery only a few, and only every peripheryPeriod-th frame in a
+// checkerboard of tiles. Frames without samples keep the pixel's accumulated mean, so the
+// periphery converges to the same image, just later. Frames that need a sample everywhere
+// (the first after a reset, camera motion) still trace one per pixel.
+// The accumulation's .a counts traced frames, not samples: a frame of one sample weighs as
+// much as a full one, which keeps the mean unbiased but makes periphery frames noisier.
+struct RegionOfInterest
+{
+    bool enabled = false;
+    glm::vec2 center = glm::vec2(0.5f);     // of the frame, y up
+    float radius = 0.2f;                    // of the frame height; full samples inside
+    int peripherySamples = 1;
+    int peripheryPeriod = 2;
+};
+
+// Per-tile samples and periods for the SAMPLE_BUDGET variant of raytracer.cs. The buffer is
+// only rewritten when the region, the frame size or the sample count changes, the shader
+// picks the frames a tile is traced in from the frame index.
+class SampleBudget
+{
+public:
+    SampleBudget()
+        : tilesX(0), tilesY(0), samples(0)
+    {
+        glGenBuffers(1, &buffer);
+    }
+
+    ~SampleBudget()
+    {
+        glDeleteBuffers(1, &buffer);
+    }
+
+    SampleBudget(const SampleBudget&) = delete;
+    SampleBudget& operator=(const SampleBudget&) = delete;
+
+    // Tiles within the radius get every sample, up to half the radius further out half of them
+    void update(int width, int height, const RegionOfInterest& roi, int samplesPerFrame)
+    {
+        int tilesX = (width + SAMPLE_BUDGET_TILE - 1) / SAMPLE_BUDGET_TILE;
+        int tilesY = (height + SAMPLE_BUDGET_TILE - 1) / SAMPLE_BUDGET_TILE;
+        if (tilesX == this->tilesX && tilesY == this->tilesY && samplesPerFrame == samples &&
+            roi.center == region.center && roi.radius == region.radius &&
+            roi.peripherySamples == region.peripherySamples && roi.peripheryPeriod == region.peripheryPeriod)
+        {
+            return;
+        }
+        this->tilesX = tilesX;
+        this->tilesY = tilesY;
+        samples = samplesPerFrame;
+        region = roi;
+
+        glm::vec2 center = roi.center * glm::vec2(width, height);
+        float radius = roi.radius * height;
+        GLuint inner = GLuint(samplesPerFrame) | 1u << 16;
+        GLuint ring = GLuint(std::max(samplesPerFrame / 2, 1)) | 1u << 16;
+        GLuint periphery = GLuint(std::min(std::max(roi.peripherySamples, 1), samplesPerFrame))
+            | GLuint(std::max(roi.peripheryPeriod, 1)) << 16;
+
+        // tilesX, then one (samples | period << 16) per tile, rows bottom to top
+        std::vector<GLuint> data(1 + size_t(tilesX) * tilesY);
+        data[0] = GLuint(tilesX);
+        for (int y = 0; y < tilesY; y++)
+        {
+            for (int x = 0; x < tilesX; x++)
+            {
+                // distance from the center to the nearest point of the tile
+                glm::vec2 lower = glm::vec2(x, y) * float(SAMPLE_BUDGET_TILE);
+                glm::vec2 nearest = glm::clamp(center, lower, lower + float(SAMPLE_BUDGET_TILE));
+                float distance = glm::length(nearest - center);
+                data[1 + size_t(y) * tilesX + x] = distance <= radius ? inner : distance <= radius * 1.5f ? ring : periphery;
+            }
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, data.size() * sizeof(GLuint), data.data(), GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    void bind() const
+    {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SAMPLE_BUDGET_BINDING, buffer);
+    }
+
+private:
+    GLuint buffer;
+    int tilesX;
+    int tilesY;
+    int samples;
+    RegionOfInterest region;
+};
+
+#endif
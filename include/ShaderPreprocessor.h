@@ -0,0 +1,30 @@
+#ifndef SHADER_PREPROCESSOR_H
+#define SHADER_PREPROCESSOR_H
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// A shader file with its #include "name" lines replaced by the named files
+struct ShaderSource
+{
+    std::string code;
+    // Every file the code was built from, the shader itself first. The index of a file is its
+    // source string number in #line directives, so compiler messages read "<index>:<line>(...)".
+    std::vector<std::string> files;
+    // last write time of each file when it was read, min() if it could not be read
+    std::vector<std::filesystem::file_time_type> writeTimes;
+
+    // true if any of the files was written, created or deleted since
+    bool changed() const;
+    // "source string 1 is .../sampling.glsl" lines for the included files
+    std::string describeFiles() const;
+};
+
+// Reads path and resolves #include "name" relative to RESOURCES_PATH, recursively. Each file
+// is included once, later #includes of it are dropped, so modules can include what they use.
+// A file that cannot be read leaves an #error behind, the compile then fails with its name.
+// The directive has to start its line; it is also honoured inside block comments.
+ShaderSource preprocessShader(const std::string& path);
+
+#endif
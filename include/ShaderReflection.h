@@ -0,0 +1,63 @@
+#ifndef SHADER_REFLECTION_H
+#define SHADER_REFLECTION_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Uniform slot of a shader wrapper, see ShaderReflection::handle()
+struct UniformHandle
+{
+    int slot = -1;
+};
+
+// Active uniforms, uniform blocks and shader storage blocks of a linked program, queried once
+// with the program interface API so per-frame code never calls glGetUniformLocation.
+// Handles name a uniform independently of the program: reflect() on a recompiled or
+// hot-reloaded program resolves every handle again, so they can be kept for good.
+class ShaderReflection
+{
+public:
+    void reflect(GLuint program);
+
+    // -1 if the program has no such active uniform, glUniform* then ignores the call
+    GLint uniformLocation(const char* name) const { return uniforms.find(name); }
+    // binding point of a block, -1 if the program has none by that name
+    GLint uniformBlockBinding(const char* name) const { return uniformBlocks.find(name); }
+    GLint storageBlockBinding(const char* name) const { return storageBlocks.find(name); }
+
+    UniformHandle handle(const char* name);
+    GLint location(UniformHandle handle) const { return handle.slot >= 0 ? handleLocations[handle.slot] : -1; }
+
+private:
+    // Open addressing over FNV-1a hashes of the names, linear probing
+    class NameTable
+    {
+    public:
+        void clear() { entries.clear(); count = 0; }
+        void insert(const std::string& name, GLint value);
+        GLint find(const char* name) const;
+
+    private:
+        struct Entry
+        {
+            uint32_t hash = 0;
+            GLint value = -1;
+            std::string name;   // empty for a free entry
+        };
+        std::vector<Entry> entries;
+        size_t count = 0;
+    };
+
+    static void readResources(GLuint program, GLenum interface, GLenum property, NameTable& table);
+
+    NameTable uniforms;
+    NameTable uniformBlocks;
+    NameTable storageBlocks;
+    std::vector<std::string> handleNames;
+    std::vector<GLint> handleLocations;
+};
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include <glad/glad.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ComputeShader.h"
+
+// Compiles compute programs on a thread of its own, with a context that shares objects with
+// the render context. makeCurrent/release run on that thread, e.g. around glfwMakeContextCurrent
+// of a hidden window created with the main window as share. Every program is glFinish()ed
+// before its future is ready, so the render context can use it as soon as it sees it.
+class ShaderCompiler
+{
+public:
+    ShaderCompiler(std::function<void()> makeCurrent, std::function<void()> release);
+    // drops queued compiles, a program being compiled is finished first
+    ~ShaderCompiler();
+
+    ShaderCompiler(const ShaderCompiler&) = delete;
+    ShaderCompiler& operator=(const ShaderCompiler&) = delete;
+
+    // resolves to the program, or 0 if it did not compile
+    std::future<GLuint> compile(std::string source, std::string fileNames = std::string());
+
+private:
+    struct Job
+    {
+        std::string source;
+        std::string fileNames;
+        std::promise<GLuint> program;
+    };
+
+    void workerLoop();
+
+    std::function<void()> makeCurrent;
+    std::function<void()> release;
+    std::mutex mutex;
+    std::condition_variable jobAvailable;
+    std::deque<Job> jobs;
+    bool stopping = false;
+    std::thread worker;
+};
+
+// Compiled permutations of one compute shader, keyed by their define set. The first request
+// for a set compiles it; with a ShaderCompiler that happens in the background and get()
+// returns 0 until the variant is ready, so the caller keeps using the one it has and the
+// render thread never waits on the GLSL compiler.
+//
+// reload() re-reads a shader whose files were edited and starts a new generation of variants.
+// A pass that calls select() every frame keeps its program until the new generation's variant
+// is ready, and for good if it does not compile.
+class ShaderVariants
+{
+public:
+    explicit ShaderVariants(const char* path);
+    // deletes every variant, waiting for ones still being compiled
+    ~ShaderVariants();
+
+    ShaderVariants(const ShaderVariants&) = delete;
+    ShaderVariants& operator=(const ShaderVariants&) = delete;
+
+    // Program for defines, or 0 while it is compiled in the background. Without a compiler
+    // it compiles right away. A variant that failed to compile keeps returning 0.
+    GLuint get(const ShaderDefines& defines, ShaderCompiler* compiler = nullptr);
+
+    // Program the pass should use now: the variant for defines of the latest generation once it
+    // is ready, until then the program selected before. Replaced generations are deleted when
+    // switching away from them.
+    GLuint select(const ShaderDefines& defines, ShaderCompiler* compiler = nullptr);
+
+    // Starts a new generation if any file of the shader changed, true if it did
+    bool reload();
+    unsigned getGeneration() const { return generation; }
+
+    size_t size() const { return programs.size(); }
+
+    // the shader file and everything it includes, see ShaderSource
+    const ShaderSource& getSource() const { return source; }
+
+private:
+    static std::string key(const ShaderDefines& defines);
+    void releaseRetired();
+
+    std::string path;
+    ShaderSource source;
+    std::map<std::string, GLuint> programs;
+    std::map<std::string, std::future<GLuint>> pending;
+
+    unsigned generation = 0;
+    GLuint selected = 0;
+    std::string selectedKey;
+    unsigned selectedGeneration = 0;
+    // variants of earlier generations, compiled or still compiling
+    std::vector<GLuint> retired;
+    std::vector<std::future<GLuint>> retiredPending;
+};
+
+#endif
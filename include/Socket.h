@@ -0,0 +1,44 @@
+#ifndef SOCKET_H
+#define SOCKET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Blocking stream socket, just enough for the coordinator and its workers. Addresses are
+// "host:port", a bare "port" (all interfaces when listening, localhost when connecting) or
+// "unix:/path/to/socket" for a Unix domain socket (not available on Windows).
+class Socket
+{
+public:
+    Socket() = default;
+    ~Socket() { close(); }
+
+    Socket(Socket&& other) noexcept;
+    Socket& operator=(Socket&& other) noexcept;
+    Socket(const Socket&) = delete;
+    Socket& operator=(const Socket&) = delete;
+
+    // both return an invalid socket (and print why) on failure
+    static Socket listen(const std::string& address);
+    static Socket connect(const std::string& address);
+
+    // waits up to timeoutMs for a connection, an invalid socket on timeout
+    Socket accept(int timeoutMs);
+
+    bool sendAll(const void* data, size_t size);
+    bool receiveAll(void* data, size_t size);
+
+    bool valid() const { return handle != INVALID_HANDLE; }
+    void close();
+
+private:
+    static const intptr_t INVALID_HANDLE = -1;
+
+    explicit Socket(intptr_t handle) : handle(handle) {}
+
+    intptr_t handle = INVALID_HANDLE;   // file descriptor, or SOCKET on Windows
+    std::string unixPath;               // removed when the listening socket closes
+};
+
+#endif
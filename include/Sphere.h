@@ -1,11 +1,12 @@
 #ifndef SPHERE_H
 #define SPHERE_H
 
-#include <GLFW/glfw3.h>
 #include <vector>
 #include <cmath>
 
-#include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "demoShaderLoader.h"
 
 #define M_PI 3.14159265358979323846
 
@@ -15,7 +16,7 @@ public:
         float radius = 1.0f,
         unsigned int sectors = 36,
         unsigned int stacks = 18)
-        : position(position), radius(radius), sectors(sectors), stacks(stacks) {
+        : position(position), radius(radius), sectors(sectors), stacks(stacks), shader(nullptr) {
         generateVertices();
         setupBuffers();
         updateModelMatrix();
@@ -27,15 +28,19 @@ public:
         glDeleteBuffers(1, &EBO);
     }
 
-    void draw(GLuint shaderProgram, const glm::mat4& view, const glm::mat4& projection) {
-        // Set transformation matrices in shader
-        GLuint modelLoc = glGetUniformLocation(shaderProgram, "model");
-        GLuint viewLoc = glGetUniformLocation(shaderProgram, "view");
-        GLuint projLoc = glGetUniformLocation(shaderProgram, "projection");
+    // Looks up the shader's transformation uniforms once, the handles stay valid when it is reloaded
+    void setShader(Shader& shader) {
+        this->shader = &shader;
+        modelUniform = shader.getHandle("model");
+        viewUniform = shader.getHandle("view");
+        projectionUniform = shader.getHandle("projection");
+    }
 
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(modelMatrix));
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-        glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
+    // the shader from setShader() has to be in use
+    void draw(const glm::mat4& view, const glm::mat4& projection) {
+        shader->setMat4(modelUniform, modelMatrix);
+        shader->setMat4(viewUniform, view);
+        shader->setMat4(projectionUniform, projection);
 
         glBindVertexArray(VAO);
         glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
@@ -65,6 +70,8 @@ private:
     std::vector<unsigned int> indices;
     GLuint VAO, VBO, EBO;
     glm::mat4 modelMatrix;
+    Shader* shader;
+    UniformHandle modelUniform, viewUniform, projectionUniform;
 
     void updateModelMatrix() {
         modelMatrix = glm::mat4(1.0f);
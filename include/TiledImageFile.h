@@ -0,0 +1,47 @@
+#ifndef TILED_IMAGE_FILE_H
+#define TILED_IMAGE_FILE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// Output image written one tile at a time, for frames too large to keep in memory. Only
+// formats with a fixed layout are supported, so every tile row can be seeked to directly:
+// binary PPM (8-bit), PFM and uncompressed scanline EXR (linear, stored as half).
+// Tiles come in bottom to top like everything read back from GL, (x, y) is the tile's lower
+// left pixel in that orientation.
+class TiledImageFile
+{
+public:
+    TiledImageFile() = default;
+    ~TiledImageFile() { close(); }
+
+    TiledImageFile(const TiledImageFile&) = delete;
+    TiledImageFile& operator=(const TiledImageFile&) = delete;
+
+    // the format follows the extension, false for anything but .ppm, .pfm and .exr
+    bool open(const std::string& path, int width, int height);
+    bool close();
+
+    // true for the linear formats, which take RGB floats, PPM takes RGBA8
+    bool isFloat() const { return format != FORMAT_PPM; }
+
+    // stride is the number of pixels between two rows of the source
+    bool writeTile(int x, int y, int tileWidth, int tileHeight, int stride, const unsigned char* rgba);
+    bool writeTile(int x, int y, int tileWidth, int tileHeight, int stride, const float* rgb);
+
+private:
+    enum Format { FORMAT_PPM, FORMAT_PFM, FORMAT_EXR };
+
+    bool seek(uint64_t offset);
+
+    FILE* file = nullptr;
+    std::string path;
+    Format format = FORMAT_PPM;
+    int width = 0;
+    int height = 0;
+    uint64_t dataOffset = 0;    // first byte after the header (EXR: of the first scanline block)
+    bool failed = false;
+};
+
+#endif
@@ -0,0 +1,131 @@
+#ifndef UNIFORM_RING_H
+#define UNIFORM_RING_H
+
+#include <glad/glad.h>
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// Per-frame uniform data streamed through one buffer split into `depth` frame slots. The
+// buffer is persistently and coherently mapped (glBufferStorage), so an upload is a memcpy
+// and glBindBufferRange, with no glBufferSubData that could make the driver wait for draws
+// still reading the old contents. A fence behind each frame keeps its slot from being
+// rewritten until the GPU is done with it, with 3 slots that wait practically never happens.
+// Without GL 4.4 / ARB_buffer_storage it maps each upload unsynchronized instead, still
+// guarded by the same fences.
+class UniformRing
+{
+public:
+    // frameSize: bytes one frame uploads in total, before alignment of each upload
+    UniformRing(size_t frameSize, int depth = 3)
+        : slots(depth), head(0), offset(0), mapped(nullptr)
+    {
+        GLint alignment = 256;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        this->alignment = alignment;
+        // room for up to 8 uploads, each starting on an alignment boundary
+        slotSize = align(frameSize + 8 * this->alignment);
+
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        GLsizeiptr size = GLsizeiptr(slotSize * slots.size());
+        if (GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage)
+        {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_UNIFORM_BUFFER, size, nullptr, flags);
+            mapped = (char*)glMapBufferRange(GL_UNIFORM_BUFFER, 0, size, flags);
+        }
+        else
+        {
+            glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_STREAM_DRAW);
+        }
+    }
+
+    ~UniformRing()
+    {
+        for (Slot& slot : slots)
+        {
+            if (slot.fence) glDeleteSync(slot.fence);
+        }
+        if (mapped)
+        {
+            glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+            glUnmapBuffer(GL_UNIFORM_BUFFER);
+        }
+        glDeleteBuffers(1, &buffer);
+    }
+
+    UniformRing(const UniformRing&) = delete;
+    UniformRing& operator=(const UniformRing&) = delete;
+
+    // Starts writing the next slot, waiting for the GPU to finish the frame that used it last
+    void beginFrame()
+    {
+        Slot& slot = slots[head];
+        if (slot.fence)
+        {
+            for (;;)
+            {
+                GLenum result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+                if (result != GL_TIMEOUT_EXPIRED) break;
+            }
+            glDeleteSync(slot.fence);
+            slot.fence = nullptr;
+        }
+        offset = 0;
+    }
+
+    // Copies data into the current slot and binds that range at the uniform buffer binding
+    void upload(GLuint binding, const void* data, size_t size)
+    {
+        size_t start = head * slotSize + offset;
+        if (offset + size > slotSize)
+        {
+            std::cout << "UniformRing: frame slot of " << slotSize << " bytes is full" << std::endl;
+            return;
+        }
+        if (mapped)
+        {
+            std::memcpy(mapped + start, data, size);
+        }
+        else
+        {
+            glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+            void* range = glMapBufferRange(GL_UNIFORM_BUFFER, start, size,
+                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+            if (range)
+            {
+                std::memcpy(range, data, size);
+                glUnmapBuffer(GL_UNIFORM_BUFFER);
+            }
+        }
+        glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, start, size);
+        offset = align(offset + size);
+    }
+
+    // call after the last command reading this frame's uploads
+    void endFrame()
+    {
+        slots[head].fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        head = (head + 1) % slots.size();
+    }
+
+private:
+    struct Slot
+    {
+        GLsync fence = nullptr;
+    };
+
+    size_t align(size_t size) const { return (size + alignment - 1) / alignment * alignment; }
+
+    GLuint buffer;
+    size_t alignment;
+    size_t slotSize;
+    std::vector<Slot> slots;
+    size_t head;    // slot of the current frame
+    size_t offset;  // next free byte in it
+    char* mapped;   // whole buffer, null without persistent mapping
+};
+
+#endif
@@ -4,6 +4,8 @@
 
 #include <string>
 
+#include "ShaderReflection.h"
+
 struct Shader
 {
 	GLuint id = 0;
@@ -22,13 +24,21 @@ struct Shader
 
 	GLint getUniform(const char *name);
 
-
-	void setBool(const std::string& name, bool value) const;
-	void setInt(const std::string& name, int value) const;
-	void setFloat(const std::string& name, float value) const;
-	void setVec4f(const std::string& name, float x, float y, float z, float w) const;
-	void setVec3(const std::string& name, float x, float y, float z)const;
-	void setMat4(const std::string& name, const glm::mat4& mat)const;
+	//handle of a uniform for the setters below, stays valid when the program is reloaded
+	UniformHandle getHandle(const char *name) { return reflection.handle(name); }
+
+	void setBool(const char *name, bool value) const;
+	void setInt(const char *name, int value) const;
+	void setInt(UniformHandle uniform, int value) const;
+	void setFloat(const char *name, float value) const;
+	void setFloat(UniformHandle uniform, float value) const;
+	void setVec4f(const char *name, float x, float y, float z, float w) const;
+	void setVec3(const char *name, float x, float y, float z)const;
+	void setMat4(const char *name, const glm::mat4& mat)const;
+	void setMat4(UniformHandle uniform, const glm::mat4& mat)const;
+
+	//filled in whenever a program is loaded
+	ShaderReflection reflection;
 };
 
 GLint getUniform(GLuint shaderId, const char *name);
@@ -2,9 +2,59 @@
 out vec4 FragColor;
 in vec2 TexCoords;
 
+//Resolve pass: turns the raw accumulation (rgb sum, a sample count) into a displayable
+//image. The output is written to an sRGB render target, so the hardware does the encode.
 
+const int TONEMAP_NONE = 0;
+const int TONEMAP_ACES = 1;
+const int TONEMAP_FILMIC = 2;
 
 uniform sampler2D screenTexture;
+uniform float exposure = 1.0;
+uniform int tonemapOperator = TONEMAP_ACES;
+
+//Narkowicz's fit of the ACES reference rendering transform
+vec3 tonemapACES(vec3 x)
+{
+    const float a = 2.51;
+    const float b = 0.03;
+    const float c = 2.43;
+    const float d = 0.59;
+    const float e = 0.14;
+    return clamp((x * (a * x + b)) / (x * (c * x + d) + e), 0.0, 1.0);
+}
+
+//Hable's filmic curve, normalized so that the linear white point maps to 1
+vec3 hableCurve(vec3 x)
+{
+    const float A = 0.15;
+    const float B = 0.50;
+    const float C = 0.10;
+    const float D = 0.20;
+    const float E = 0.02;
+    const float F = 0.30;
+    return ((x * (A * x + C * B) + D * E) / (x * (A * x + B) + D * F)) - E / F;
+}
+
+vec3 tonemapFilmic(vec3 x)
+{
+    const float WHITE_POINT = 11.2;
+    return clamp(hableCurve(x * 2.0) / hableCurve(vec3(WHITE_POINT)), 0.0, 1.0);
+}
+
 void main() {
-    FragColor = texture(screenTexture, TexCoords);
-}
\ No newline at end of file
+    vec4 accumulated = texture(screenTexture, TexCoords);
+    vec3 color = accumulated.rgb / max(accumulated.a, 1.0) * exposure;
+
+    if (tonemapOperator == TONEMAP_ACES) {
+        color = tonemapACES(color);
+    }
+    else if (tonemapOperator == TONEMAP_FILMIC) {
+        color = tonemapFilmic(color);
+    }
+    else {
+        color = clamp(color, 0.0, 1.0);
+    }
+
+    FragColor = vec4(color, 1.0);
+}
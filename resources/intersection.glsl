@@ -0,0 +1,68 @@
+//Rays, hit records and primitive intersection tests. COUNT(counter) may be defined before
+//the include to count the tests (see RAY_STATS in raytracer.cs).
+#ifndef COUNT
+#define COUNT(counter)
+#endif
+
+const float MIN_DIST = 0.0001;  
+const float MAX_DIST = 1000.0;
+
+//Material types
+const int MATERIAL_DIFFUSE = 0;
+const int MATERIAL_METAL = 1;
+const int MATERIAL_GLASS = 2;
+
+struct Material
+{
+    int type;
+    vec3 albedo;
+    float roughness;  
+    float ior;     //index of refraction
+};
+
+struct Ray
+{
+    vec3 origin;
+    vec3 direction;
+};
+
+struct HitRecord
+{
+    vec3 p;
+    vec3 normal;
+    float t;
+    bool front_face;
+    Material material;
+};
+
+bool intersectSphere(Ray ray, vec3 center, float radius, out HitRecord rec)
+{
+    COUNT(primitiveTestCount);
+    vec3 oc = ray.origin - center;
+    float a = dot(ray.direction, ray.direction);
+    float half_b = dot(oc, ray.direction);
+    float c = dot(oc, oc) - radius * radius;
+    float discriminant = half_b * half_b - a * c;
+
+    if (discriminant < 0.0) return false;
+
+    float sqrtd = sqrt(discriminant);
+    
+    float root = (-half_b - sqrtd) / a;
+
+    if (root < MIN_DIST || root > MAX_DIST)
+    {
+        root = (-half_b + sqrtd) / a;  
+        if (root < MIN_DIST || root > MAX_DIST)
+            return false;
+    }
+
+    rec.t = root;
+    rec.p = ray.origin + rec.t * ray.direction;
+    vec3 outward_normal = (rec.p - center) / radius;
+    rec.front_face = dot(ray.direction, outward_normal) < 0;
+    rec.normal = rec.front_face ? outward_normal : -outward_normal;
+
+    rec.normal = normalize(rec.normal);
+    return true;
+}
@@ -0,0 +1,77 @@
+//Material scattering. A scene without metal or glass surfaces can leave their code out.
+#ifndef SCENE_HAS_METAL
+#define SCENE_HAS_METAL 1
+#endif
+#ifndef SCENE_HAS_GLASS
+#define SCENE_HAS_GLASS 1
+#endif
+
+#include "intersection.glsl"
+#include "sampling.glsl"
+
+//Material Functions
+vec3 reflect(vec3 v, vec3 n)
+{
+    return v - 2.0 * dot(v, n) * n;
+}
+
+vec3 refract(vec3 uv, vec3 n, float etai_over_etat)
+{
+    float cos_theta = min(dot(-uv, n), 1.0);
+    vec3 r_out_perp = etai_over_etat * (uv + cos_theta * n);
+    vec3 r_out_parallel = -sqrt(abs(1.0 - dot(r_out_perp, r_out_perp))) * n;
+    return r_out_perp + r_out_parallel;
+}
+
+//Schlick approximation for glass reflectivity
+float schlick(float cosine, float ref_idx)
+{
+    float r0 = (1.0 - ref_idx) / (1.0 + ref_idx);
+    r0 = r0 * r0;
+    return r0 + (1.0 - r0) * pow((1.0 - cosine), 5.0);
+}
+
+//ray scatter function
+bool scatter(Ray r_in, HitRecord rec, out vec3 attenuation, out Ray scattered)
+{
+    if (rec.material.type == MATERIAL_DIFFUSE)
+    {
+        vec3 scatter_direction = rec.normal + random_unit_vector();
+        scattered = Ray(rec.p, normalize(scatter_direction));
+        attenuation = rec.material.albedo;
+        return true;
+    }
+#if SCENE_HAS_METAL
+    else if (rec.material.type == MATERIAL_METAL)
+    {
+        vec3 reflected = reflect(normalize(r_in.direction), rec.normal);
+        scattered = Ray(rec.p, normalize(reflected + rec.material.roughness * random_unit_vector()));
+        attenuation = rec.material.albedo;
+        return dot(scattered.direction, rec.normal) > 0.0;
+    }
+#endif
+#if SCENE_HAS_GLASS
+    else if (rec.material.type == MATERIAL_GLASS)
+    {
+        attenuation = vec3(1.0);
+        float refraction_ratio = rec.front_face ?
+            (1.0 / rec.material.ior) : rec.material.ior;
+
+        vec3 unit_direction = normalize(r_in.direction);
+        float cos_theta = min(dot(-unit_direction, rec.normal), 1.0);
+        float sin_theta = sqrt(1.0 - cos_theta * cos_theta);
+
+        bool cannot_refract = refraction_ratio * sin_theta > 1.0;
+        vec3 direction;
+
+        if (cannot_refract || schlick(cos_theta, refraction_ratio) > random_float())
+            direction = reflect(unit_direction, rec.normal);
+        else
+            direction = refract(unit_direction, rec.normal, refraction_ratio);
+
+        scattered = Ray(rec.p, direction);
+        return true;
+    }
+#endif
+    return false;
+}
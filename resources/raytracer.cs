@@ -1,24 +1,102 @@
 #version 430
 layout(local_size_x = 16, local_size_y = 16) in;
-layout(rgba32f, binding = 0) uniform image2D imgOutput;
+
+//Compile-time configuration. Renderer compiles a variant per combination it needs (see
+//ShaderVariants.h) and injects these as #defines; the defaults only apply to a plain compile.
+//SCENE_HAS_METAL and SCENE_HAS_GLASS (materials.glsl) leave a sphere and its material out.
+#ifndef SAMPLES
+#define SAMPLES 4           //samples per pixel and frame
+#endif
+#ifndef MAX_BOUNCES
+#define MAX_BOUNCES 100
+#endif
+#ifndef RAY_STATS
+#define RAY_STATS 0         //count rays into RayStatsBuffer
+#endif
+#ifndef SAMPLE_BUDGET
+#define SAMPLE_BUDGET 0     //samples per tile from SampleBudgetBuffer, at most SAMPLES
+#endif
+
 layout(std140, binding = 1) uniform AccumulationBlock
 {
     uint frameCount;
+    uint reprojectHistory;     //camera moved: write currentSample and let reproject.cs accumulate
+    uint maxHistoryFrames;
+    uint accumulateMoments;    //denoiser enabled: also accumulate luminance moments
+};
+//Ping-pong accumulation: rgb holds the running sum, a the number of accumulated frames
+layout(rgba32f, binding = 1) uniform readonly image2D accumulationHistory;
+layout(rgba32f, binding = 2) uniform writeonly image2D accumulationImage;
+//Sums of demodulated luminance and luminance squared, for the denoiser's variance estimate
+layout(rg32f, binding = 5) uniform readonly image2D momentsHistory;
+layout(rg32f, binding = 6) uniform writeonly image2D momentsImage;
+
+//G-buffer of the primary (pixel center) hit, see encode_gbuffer()
+layout(rgba32ui, binding = 0) uniform writeonly uimage2D gbufferImage;
+layout(rgba16f, binding = 3) uniform writeonly image2D currentSample;
+
+//Tiled rendering: the images only cover the tile starting at tileOffset of an
+//imageResolution sized frame. A whole frame is a single tile at offset 0.
+uniform ivec2 tileOffset;
+uniform ivec2 imageResolution;
+
+//Index of this frame in the whole render (frameCount plus the first frame of the rendered
+//range). Random numbers derive from it and the pixel only, so disjoint frame ranges rendered
+//in separate runs add up to exactly the samples of one long run.
+uniform uint frameIndex;
+
+//Path statistics (RayCounters in RayStats.h). Every invocation counts into the globals below,
+//main() sums them per work group in shared memory and adds the group's totals to the buffer
+//with a single atomic per counter, only while collectStats is set.
+#if RAY_STATS
+uniform bool collectStats;
+layout(std430, binding = 0) buffer RayStatsBuffer
+{
+    uint totalRays;
+    uint totalBounces;
+    uint totalTerminations;
+    uint totalPrimitiveTests;
+    uint totalPaths;
+};
+const int RAY_STATS_COUNTERS = 5;
+shared uint groupStats[RAY_STATS_COUNTERS];
+uint rayCount = 0u;
+uint bounceCount = 0u;
+uint terminationCount = 0u;
+uint primitiveTestCount = 0u;
+uint pathCount = 0u;
+#define COUNT(counter) counter++
+#else
+#define COUNT(counter)
+#endif
+
+#if SAMPLE_BUDGET
+//Region of interest sampling (SampleBudget.h): per 16x16 tile of the frame the samples per
+//pixel in the low 16 bits and a period in the high ones, the tile is only traced every
+//period-th frame, in a checkerboard of tiles
+layout(std430, binding = 1) readonly buffer SampleBudgetBuffer
+{
+    uint budgetTilesX;
+    uint tileBudget[];
 };
-layout(rgba32f, binding = 1) uniform image2D accumulationImage;
-
-//Global variables
-const float MIN_DIST = 0.0001;  
-const float MAX_DIST = 1000.0;
-
-//Anti alsiasing
-const int SAMPLES = 4;
-const float ONE_OVER_SAMPLES = 1.0 / float(SAMPLES);
 
-//Material types
-const int MATERIAL_DIFFUSE = 0;
-const int MATERIAL_METAL = 1;
-const int MATERIAL_GLASS = 2;
+uint pixel_samples(ivec2 framePixel)
+{
+    ivec2 tile = framePixel / 16;
+    uint budget = tileBudget[tile.y * int(budgetTilesX) + tile.x];
+    uint samples = min(budget & 0xffffu, uint(SAMPLES));
+    if ((uint(tile.x + tile.y) + frameIndex) % max(budget >> 16, 1u) != 0u)
+    {
+        samples = 0u;
+    }
+    //the first frame after a reset and reproject.cs need a sample in every pixel
+    if (frameCount == 1u || reprojectHistory != 0u)
+    {
+        samples = max(samples, 1u);
+    }
+    return samples;
+}
+#endif
 
 //Camera uniforms 
 layout(std140, binding = 0) uniform CameraBlock
@@ -29,101 +107,17 @@ layout(std140, binding = 0) uniform CameraBlock
     vec4 cameraRight;
     vec2 fovAndAspect;
     vec2 padding;
+    vec4 prevCameraPos;
+    vec4 prevCameraFront;
+    vec4 prevCameraUp;
+    vec4 prevCameraRight;
+    vec2 prevFovAndAspect;
+    vec2 prevPadding;
 };
 
-struct Material
-{
-    int type;
-    vec3 albedo;
-    float roughness;  
-    float ior;     //index of refraction
-};
-
-struct Ray
-{
-    vec3 origin;
-    vec3 direction;
-};
-
-struct HitRecord
-{
-    vec3 p;
-    vec3 normal;
-    float t;
-    bool front_face;
-    Material material;
-};
-
-
-uint seed;
-uint wang_hash(uint seed)
-{
-    seed = (seed ^ 61) ^ (seed >> 16);
-    seed *= 9;
-    seed = seed ^ (seed >> 4);
-    seed *= 0x27d4eb2d;
-    seed = seed ^ (seed >> 15);
-    return seed;
-}
-
-float random_float()
-{
-    seed = wang_hash(seed);
-    return float(seed) / 4294967296.0;
-}
-
-vec3 random_unit_vector()
-{
-    float z = random_float() * 2.0 - 1.0;
-    float a = random_float() * 2.0 * 3.1415926;
-    float r = sqrt(1.0 - z * z);
-    return vec3(r * cos(a), r * sin(a), z);
-}
-
-vec3 random_on_hemisphere(vec3 normal)
-{
-    vec3 on_unit_sphere = random_unit_vector();
-    return dot(on_unit_sphere, normal) > 0.0 ? on_unit_sphere : -on_unit_sphere;
-}
-
-vec2 random_in_unit_square()
-{
-    return vec2(random_float(), random_float());
-}
-
-//Material Functions
-vec3 reflect(vec3 v, vec3 n)
-{
-    return v - 2.0 * dot(v, n) * n;
-}
-
-vec3 refract(vec3 uv, vec3 n, float etai_over_etat)
-{
-    float cos_theta = min(dot(-uv, n), 1.0);
-    vec3 r_out_perp = etai_over_etat * (uv + cos_theta * n);
-    vec3 r_out_parallel = -sqrt(abs(1.0 - dot(r_out_perp, r_out_perp))) * n;
-    return r_out_perp + r_out_parallel;
-}
-
-//Schlick approximation for glass reflectivity
-float schlick(float cosine, float ref_idx)
-{
-    float r0 = (1.0 - ref_idx) / (1.0 + ref_idx);
-    r0 = r0 * r0;
-    return r0 + (1.0 - r0) * pow((1.0 - cosine), 5.0);
-}
-
-vec2 get_subpixel_offset(int sampleIdx)
-{
-    int x = sampleIdx % 2;
-    int y = sampleIdx / 2;
-
-    vec2 stratifiedPos = vec2(x, y) * 0.5;
-    vec2 jitter = random_in_unit_square() * 0.5;
-
-    return stratifiedPos + jitter;
-}
-
+#include "sampling.glsl"
+#include "intersection.glsl"
+#include "materials.glsl"
 
 Ray createCameraRay(vec2 uv)
 {
@@ -142,76 +136,79 @@ Ray createCameraRay(vec2 uv)
     return Ray(cameraPos.xyz, rayDir);
 }
 
-bool intersectSphere(Ray ray, vec3 center, float radius, out HitRecord rec)
-{
-    vec3 oc = ray.origin - center;
-    float a = dot(ray.direction, ray.direction);
-    float half_b = dot(oc, ray.direction);
-    float c = dot(oc, oc) - radius * radius;
-    float discriminant = half_b * half_b - a * c;
+// Define materials
+const Material diffuse_material = Material(MATERIAL_DIFFUSE, vec3(0.7, 0.3, 0.3), 0.0, 0.0);
+const Material metal_material = Material(MATERIAL_METAL, vec3(0.8, 0.8, 0.8), 0.1, 0.0);
+const Material glass_material = Material(MATERIAL_GLASS, vec3(1.0), 0.0, 1.0);
+const Material ground_material = Material(MATERIAL_DIFFUSE, vec3(0.1, 0.1, 0.1), 0.0, 0.0);
 
-    if (discriminant < 0.0) return false;
+// Spheres with different materials
+const vec3 sphere1_center = vec3(-2.0, 0.0, -3.0);  // Diffuse
+const vec3 sphere2_center = vec3(0.0, 0.0, -3.0);   // Metal
+const vec3 sphere3_center = vec3(2.0, 0.0, -3.0);   // Glass
+const vec3 ground_center = vec3(0.0, -1001.0, -3.0);
 
-    float sqrtd = sqrt(discriminant);
-    
-    float root = (-half_b - sqrtd) / a;
+const float sphere_radius = 1.0;
+const float ground_radius = 1000.0;
+
+//closest hit against the whole scene
+bool hit_scene(Ray current_ray, out HitRecord rec)
+{
+    COUNT(rayCount);
+    bool hit_anything = false;
+    float closest_so_far = MAX_DIST;
+    HitRecord temp_rec;
 
-    if (root < MIN_DIST || root > MAX_DIST)
+    // Test all spheres
+    if (intersectSphere(current_ray, sphere1_center, sphere_radius, temp_rec))
     {
-        root = (-half_b + sqrtd) / a;  
-        if (root < MIN_DIST || root > MAX_DIST)
-            return false;
+        temp_rec.material = diffuse_material;
+        if (temp_rec.t < closest_so_far)
+        {
+            hit_anything = true;
+            closest_so_far = temp_rec.t;
+            rec = temp_rec;
+        }
     }
 
-    rec.t = root;
-    rec.p = ray.origin + rec.t * ray.direction;
-    vec3 outward_normal = (rec.p - center) / radius;
-    rec.front_face = dot(ray.direction, outward_normal) < 0;
-    rec.normal = rec.front_face ? outward_normal : -outward_normal;
-
-    rec.normal = normalize(rec.normal);
-    return true;
-}
-
-//ray scatter function
-bool scatter(Ray r_in, HitRecord rec, out vec3 attenuation, out Ray scattered)
-{
-    if (rec.material.type == MATERIAL_DIFFUSE)
+#if SCENE_HAS_METAL
+    if (intersectSphere(current_ray, sphere2_center, sphere_radius, temp_rec))
     {
-        vec3 scatter_direction = rec.normal + random_unit_vector();
-        scattered = Ray(rec.p, normalize(scatter_direction));
-        attenuation = rec.material.albedo;
-        return true;
+        temp_rec.material = metal_material;
+        if (temp_rec.t < closest_so_far)
+        {
+            hit_anything = true;
+            closest_so_far = temp_rec.t;
+            rec = temp_rec;
+        }
     }
-    else if (rec.material.type == MATERIAL_METAL)
+#endif
+
+#if SCENE_HAS_GLASS
+    if (intersectSphere(current_ray, sphere3_center, sphere_radius, temp_rec))
     {
-        vec3 reflected = reflect(normalize(r_in.direction), rec.normal);
-        scattered = Ray(rec.p, normalize(reflected + rec.material.roughness * random_unit_vector()));
-        attenuation = rec.material.albedo;
-        return dot(scattered.direction, rec.normal) > 0.0;
+        temp_rec.material = glass_material;
+        if (temp_rec.t < closest_so_far)
+        {
+            hit_anything = true;
+            closest_so_far = temp_rec.t;
+            rec = temp_rec;
+        }
     }
-    else if (rec.material.type == MATERIAL_GLASS)
-    {
-        attenuation = vec3(1.0);
-        float refraction_ratio = rec.front_face ?
-            (1.0 / rec.material.ior) : rec.material.ior;
-
-        vec3 unit_direction = normalize(r_in.direction);
-        float cos_theta = min(dot(-unit_direction, rec.normal), 1.0);
-        float sin_theta = sqrt(1.0 - cos_theta * cos_theta);
-
-        bool cannot_refract = refraction_ratio * sin_theta > 1.0;
-        vec3 direction;
+#endif
 
-        if (cannot_refract || schlick(cos_theta, refraction_ratio) > random_float())
-            direction = reflect(unit_direction, rec.normal);
-        else
-            direction = refract(unit_direction, rec.normal, refraction_ratio);
-
-        scattered = Ray(rec.p, direction);
-        return true;
+    if (intersectSphere(current_ray, ground_center, ground_radius, temp_rec))
+    {
+        temp_rec.material = ground_material;
+        if (temp_rec.t < closest_so_far)
+        {
+            hit_anything = true;
+            closest_so_far = temp_rec.t;
+            rec = temp_rec;
+        }
     }
-    return false;
+
+    return hit_anything;
 }
 
 vec3 ray_color(Ray r)
@@ -219,76 +216,12 @@ vec3 ray_color(Ray r)
     vec3 attenuation = vec3(1.0);
     Ray current_ray = r;
 
-    // Define materials
-    Material diffuse_material = Material(MATERIAL_DIFFUSE, vec3(0.7, 0.3, 0.3), 0.0, 0.0);
-    Material metal_material = Material(MATERIAL_METAL, vec3(0.8, 0.8, 0.8), 0.1, 0.0);
-    Material glass_material = Material(MATERIAL_GLASS, vec3(1.0), 0.0, 1.0);
-    Material ground_material = Material(MATERIAL_DIFFUSE, vec3(0.1, 0.1, 0.1), 0.0, 0.0);
-
-    // Spheres with different materials
-    vec3 sphere1_center = vec3(-2.0, 0.0, -3.0);  // Diffuse
-    vec3 sphere2_center = vec3(0.0, 0.0, -3.0);   // Metal
-    vec3 sphere3_center = vec3(2.0, 0.0, -3.0);   // Glass
-    vec3 ground_center = vec3(0.0, -1001.0, -3.0);
-
-    float sphere_radius = 1.0;
-    float ground_radius = 1000.0;
-
-    const int MAX_BOUNCES = 100;
+    COUNT(pathCount);
 
     for (int bounce = 0; bounce < MAX_BOUNCES; bounce++)
     {
         HitRecord rec;
-        bool hit_anything = false;
-        float closest_so_far = MAX_DIST;
-        HitRecord temp_rec;
-
-        // Test all spheres
-        if (intersectSphere(current_ray, sphere1_center, sphere_radius, temp_rec))
-        {
-            temp_rec.material = diffuse_material;
-            if (temp_rec.t < closest_so_far)
-            {
-                hit_anything = true;
-                closest_so_far = temp_rec.t;
-                rec = temp_rec;
-            }
-        }
-
-        if (intersectSphere(current_ray, sphere2_center, sphere_radius, temp_rec))
-        {
-            temp_rec.material = metal_material;
-            if (temp_rec.t < closest_so_far)
-            {
-                hit_anything = true;
-                closest_so_far = temp_rec.t;
-                rec = temp_rec;
-            }
-        }
-
-        if (intersectSphere(current_ray, sphere3_center, sphere_radius, temp_rec))
-        {
-            temp_rec.material = glass_material;
-            if (temp_rec.t < closest_so_far)
-            {
-                hit_anything = true;
-                closest_so_far = temp_rec.t;
-                rec = temp_rec;
-            }
-        }
-
-        if (intersectSphere(current_ray, ground_center, ground_radius, temp_rec))
-        {
-            temp_rec.material = ground_material;
-            if (temp_rec.t < closest_so_far)
-            {
-                hit_anything = true;
-                closest_so_far = temp_rec.t;
-                rec = temp_rec;
-            }
-        }
-
-        if (hit_anything)
+        if (hit_scene(current_ray, rec))
         {
             Ray scattered;
             vec3 scatter_attenuation;
@@ -296,14 +229,17 @@ vec3 ray_color(Ray r)
             {
                 attenuation *= scatter_attenuation;
                 current_ray = scattered;
+                COUNT(bounceCount);
 
                 if (max(max(attenuation.x, attenuation.y), attenuation.z) < 0.01)
                 {
+                    COUNT(terminationCount);
                     return vec3(0.0);
                 }
             }
             else
             {
+                COUNT(terminationCount);
                 return vec3(0.0);
             }
         }
@@ -320,48 +256,186 @@ vec3 ray_color(Ray r)
     return attenuation * 0.1;
 }
 
-void main()
+//Projects a world space point into the previous frame's camera, returns uv in [0,1]
+vec2 project_previous(vec3 p)
+{
+    vec3 d = p - prevCameraPos.xyz;
+    float z = max(dot(d, prevCameraFront.xyz), MIN_DIST);
+    float tanFov = tan(prevFovAndAspect.x * 0.5);
+    vec2 ndc = vec2(dot(d, prevCameraRight.xyz) / (prevFovAndAspect.y * tanFov),
+                    dot(d, prevCameraUp.xyz) / tanFov) / z;
+    return ndc * 0.5 + 0.5;
+}
+
+vec2 sign_not_zero(vec2 v)
+{
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+//Octahedral normal encoding, decoded by oct_decode() in reproject.cs and the svgf shaders
+vec2 oct_encode(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    return n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * sign_not_zero(n.xy);
+}
+
+//One texel holds the whole G-buffer: x normal (octahedral snorm16x2), y depth (primary ray
+//distance, float bits), z motion towards the previous frame in pixels (half2), w albedo (unorm8x4)
+uvec4 encode_gbuffer(vec3 normal, float depth, vec2 motion, vec3 albedo)
+{
+    return uvec4(packSnorm2x16(oct_encode(normal)), floatBitsToUint(depth),
+                 packHalf2x16(motion), packUnorm4x8(vec4(albedo, 1.0)));
+}
+
+//Writes the G-buffer of the pixel center's primary hit and returns its albedo
+vec3 write_gbuffer(ivec2 pixel, ivec2 framePixel, ivec2 screenSize)
+{
+    vec2 uv = (vec2(framePixel) + 0.5) / vec2(screenSize);
+    Ray primaryRay = createCameraRay(uv);
+    HitRecord primary;
+    vec3 normal = -primaryRay.direction;
+    vec3 albedo = vec3(1.0);
+    float depth = MAX_DIST;
+    if (hit_scene(primaryRay, primary))
+    {
+        normal = primary.normal;
+        albedo = primary.material.albedo;
+        depth = primary.t;
+    }
+
+    vec3 worldPos = primaryRay.origin + depth * primaryRay.direction;
+    vec2 motion = (project_previous(worldPos) - uv) * vec2(screenSize);
+
+    imageStore(gbufferImage, pixel, encode_gbuffer(normal, depth, motion, albedo));
+    return albedo;
+}
+
+float luminance(vec3 c)
+{
+    return dot(c, vec3(0.2126, 0.7152, 0.0722));
+}
+
+void trace_pixel()
 {
     ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
-    ivec2 screenSize = imageSize(imgOutput);
+    ivec2 tileSize = imageSize(accumulationImage);
+    ivec2 screenSize = imageResolution;
+    ivec2 framePixel = pixel + tileOffset;
 
-    if (pixel.x >= screenSize.x || pixel.y >= screenSize.y)
+    if (pixel.x >= tileSize.x || pixel.y >= tileSize.y ||
+        framePixel.x >= screenSize.x || framePixel.y >= screenSize.y)
     {
         return;
     }
 
-    // Initialize random seed
-    seed = uint(pixel.x ^ pixel.y ^ frameCount ^ uint(gl_GlobalInvocationID.x * 1973 + gl_GlobalInvocationID.y * 9277));
+    // Initialize random seed from the frame position, so a tiled render matches an untiled one
+    uint pixelIndex = uint(framePixel.y * screenSize.x + framePixel.x);
+    seed = wang_hash(pixelIndex * 9781u + wang_hash(frameIndex));
 
     // Accumulate samples
     vec3 pixelColor = vec3(0.0);
+#if SAMPLE_BUDGET
+    uint samples = pixel_samples(framePixel);
+#else
+    const uint samples = uint(SAMPLES);
+#endif
 
     for (int i = 0; i < SAMPLES; i++)
     {
+        if (uint(i) >= samples)
+        {
+            break;
+        }
+#if SAMPLE_BUDGET
+        //only a full set of samples covers every stratum, fewer would keep to one corner
+        //of the pixel and shift the image, so they are spread over the whole pixel
+        vec2 offset = samples == uint(SAMPLES) ? get_subpixel_offset(i) : random_in_unit_square();
+#else
         vec2 offset = get_subpixel_offset(i);
-        vec2 uv = (vec2(pixel) + offset) / vec2(screenSize);
+#endif
+        vec2 uv = (vec2(framePixel) + offset) / vec2(screenSize);
         Ray currentRay = createCameraRay(uv);
         pixelColor += ray_color(currentRay);
     }
 
     // Average samples
-    vec3 currentColor = pixelColor * ONE_OVER_SAMPLES;
+    vec3 currentColor = pixelColor / float(max(samples, 1u));
+
+    vec3 albedo = write_gbuffer(pixel, framePixel, screenSize);
+
+#if SAMPLE_BUDGET
+    // Not traced this frame, the history carries over unchanged
+    if (samples == 0u)
+    {
+        imageStore(accumulationImage, pixel, imageLoad(accumulationHistory, pixel));
+        if (accumulateMoments != 0)
+        {
+            imageStore(momentsImage, pixel, imageLoad(momentsHistory, pixel));
+        }
+        return;
+    }
+#endif
 
-    // Temporal accumulation
-    vec4 accumulatedColor = imageLoad(accumulationImage, pixel);
-    vec3 finalColor;
+    // After camera motion the history has to be reprojected, which needs the
+    // neighbourhood of this frame's samples, so that is left to reproject.cs
+    if (reprojectHistory != 0)
+    {
+        imageStore(currentSample, pixel, vec4(currentColor, 1.0));
+        return;
+    }
 
-    if (frameCount == 0)
+    // Temporal accumulation, frameCount == 1 is the first frame after a reset
+    vec4 accumulated = vec4(currentColor, 1.0);
+    if (frameCount > 1)
     {
-        finalColor = currentColor;
+        accumulated += imageLoad(accumulationHistory, pixel);
     }
-    else
+
+    if (accumulateMoments != 0)
     {
-        float weight = 1.0 / float(frameCount + 1);
-        finalColor = mix(accumulatedColor.rgb, currentColor, weight);
+        float l = luminance(currentColor / max(albedo, vec3(0.01)));
+        vec2 moments = vec2(l, l * l);
+        if (frameCount > 1)
+        {
+            moments += imageLoad(momentsHistory, pixel).rg;
+        }
+        imageStore(momentsImage, pixel, vec4(moments, 0.0, 0.0));
     }
 
-    // Store results
-    imageStore(accumulationImage, pixel, vec4(finalColor, 1.0));
-    imageStore(imgOutput, pixel, vec4(finalColor, 1.0));
-}
\ No newline at end of file
+    // Store results, the resolve pass divides by the sample count and tonemaps
+    imageStore(accumulationImage, pixel, accumulated);
+}
+
+void main()
+{
+#if RAY_STATS
+    if (gl_LocalInvocationIndex < uint(RAY_STATS_COUNTERS))
+    {
+        groupStats[gl_LocalInvocationIndex] = 0u;
+    }
+#endif
+
+    trace_pixel();
+
+#if RAY_STATS
+    //barrier() may not be called in control flow, but a group waits for its slowest
+    //invocation before retiring anyway, so the two barriers cost next to nothing
+    memoryBarrierShared();
+    barrier();
+    atomicAdd(groupStats[0], rayCount);
+    atomicAdd(groupStats[1], bounceCount);
+    atomicAdd(groupStats[2], terminationCount);
+    atomicAdd(groupStats[3], primitiveTestCount);
+    atomicAdd(groupStats[4], pathCount);
+    memoryBarrierShared();
+    barrier();
+    if (gl_LocalInvocationIndex == 0u && collectStats)
+    {
+        atomicAdd(totalRays, groupStats[0]);
+        atomicAdd(totalBounces, groupStats[1]);
+        atomicAdd(totalTerminations, groupStats[2]);
+        atomicAdd(totalPrimitiveTests, groupStats[3]);
+        atomicAdd(totalPaths, groupStats[4]);
+    }
+#endif
+}
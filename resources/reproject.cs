@@ -0,0 +1,168 @@
+#version 430
+layout(local_size_x = 16, local_size_y = 16) in;
+
+//Temporal reprojection: runs instead of the in-place accumulation of raytracer.cs on frames
+//where the camera moved. The previous accumulation is fetched at the position the primary hit
+//had last frame, rejected where the depth disagrees, clamped to the colour distribution of
+//this frame's neighbourhood and merged with the new samples.
+
+layout(std140, binding = 1) uniform AccumulationBlock
+{
+    uint frameCount;
+    uint reprojectHistory;
+    uint maxHistoryFrames;
+    uint accumulateMoments;
+};
+
+layout(std140, binding = 0) uniform CameraBlock
+{
+    vec4 cameraPos;
+    vec4 cameraFront;
+    vec4 cameraUp;
+    vec4 cameraRight;
+    vec2 fovAndAspect;
+    vec2 padding;
+    vec4 prevCameraPos;
+    vec4 prevCameraFront;
+    vec4 prevCameraUp;
+    vec4 prevCameraRight;
+    vec2 prevFovAndAspect;
+    vec2 prevPadding;
+};
+
+layout(rgba32f, binding = 1) uniform readonly image2D accumulationHistory;
+layout(rgba32f, binding = 2) uniform writeonly image2D accumulationImage;
+layout(rgba16f, binding = 3) uniform readonly image2D currentSample;
+layout(rgba32ui, binding = 0) uniform readonly uimage2D gbufferImage;
+layout(rgba32ui, binding = 4) uniform readonly uimage2D prevGbufferImage;
+layout(rg32f, binding = 5) uniform readonly image2D momentsHistory;
+layout(rg32f, binding = 6) uniform writeonly image2D momentsImage;
+
+const float MAX_DIST = 1000.0;
+//Relative depth difference above which a history sample belongs to another surface
+const float DEPTH_TOLERANCE = 0.05;
+//Width of the neighbourhood colour box in standard deviations
+const float CLAMP_GAMMA = 1.25;
+
+//G-buffer texel layout, see encode_gbuffer() in raytracer.cs
+float gbuffer_depth(uvec4 g)
+{
+    return uintBitsToFloat(g.y);
+}
+
+vec2 gbuffer_motion(uvec4 g)
+{
+    return unpackHalf2x16(g.z);
+}
+
+vec3 gbuffer_albedo(uvec4 g)
+{
+    return unpackUnorm4x8(g.w).rgb;
+}
+
+float luminance(vec3 c)
+{
+    return dot(c, vec3(0.2126, 0.7152, 0.0722));
+}
+
+//Ray direction through a uv of the current camera, mirrors createCameraRay in raytracer.cs
+vec3 currentRayDirection(vec2 uv)
+{
+    vec2 ndc = uv * 2.0 - 1.0;
+    ndc.x *= fovAndAspect.y;
+    float tanFov = tan(fovAndAspect.x * 0.5);
+    return normalize(cameraFront.xyz + ndc.x * tanFov * cameraRight.xyz + ndc.y * tanFov * cameraUp.xyz);
+}
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 screenSize = imageSize(accumulationImage);
+
+    if (pixel.x >= screenSize.x || pixel.y >= screenSize.y)
+    {
+        return;
+    }
+
+    vec3 current = imageLoad(currentSample, pixel).rgb;
+
+    //Mean and standard deviation of this frame's 3x3 neighbourhood
+    vec3 m1 = vec3(0.0);
+    vec3 m2 = vec3(0.0);
+    for (int y = -1; y <= 1; y++)
+    {
+        for (int x = -1; x <= 1; x++)
+        {
+            vec3 c = imageLoad(currentSample, clamp(pixel + ivec2(x, y), ivec2(0), screenSize - 1)).rgb;
+            m1 += c;
+            m2 += c * c;
+        }
+    }
+    m1 /= 9.0;
+    vec3 sigma = sqrt(max(m2 / 9.0 - m1 * m1, vec3(0.0)));
+    vec3 boxMin = m1 - CLAMP_GAMMA * sigma;
+    vec3 boxMax = m1 + CLAMP_GAMMA * sigma;
+
+    //World position of the primary hit and where it was seen last frame
+    vec2 uv = (vec2(pixel) + 0.5) / vec2(screenSize);
+    uvec4 gbuffer = imageLoad(gbufferImage, pixel);
+    float depth = gbuffer_depth(gbuffer);
+    vec3 worldPos = cameraPos.xyz + depth * currentRayDirection(uv);
+    float expectedDepth = length(worldPos - prevCameraPos.xyz);
+    //motion is in pixels, texel centers sit at +0.5 in both frames so they cancel
+    vec2 prevPixel = vec2(pixel) + gbuffer_motion(gbuffer);
+
+    //Bilinear history fetch, every tap is validated against last frame's depth
+    ivec2 base = ivec2(floor(prevPixel));
+    vec2 f = prevPixel - vec2(base);
+    vec4 history = vec4(0.0);
+    vec2 historyMoments = vec2(0.0);
+    float weightSum = 0.0;
+    for (int i = 0; i < 4; i++)
+    {
+        ivec2 offset = ivec2(i & 1, i >> 1);
+        ivec2 tap = base + offset;
+        if (tap.x < 0 || tap.y < 0 || tap.x >= screenSize.x || tap.y >= screenSize.y)
+        {
+            continue;
+        }
+
+        float prevDepth = gbuffer_depth(imageLoad(prevGbufferImage, tap));
+        bool sky = depth >= MAX_DIST && prevDepth >= MAX_DIST;
+        if (!sky && abs(prevDepth - expectedDepth) > DEPTH_TOLERANCE * expectedDepth)
+        {
+            continue;
+        }
+
+        vec2 w2 = mix(vec2(1.0) - f, f, vec2(offset));
+        float w = w2.x * w2.y;
+        vec4 h = imageLoad(accumulationHistory, tap);
+        if (h.a > 0.0)
+        {
+            history += w * vec4(h.rgb / h.a, h.a);
+            if (accumulateMoments != 0)
+            {
+                historyMoments += w * imageLoad(momentsHistory, tap).rg / h.a;
+            }
+            weightSum += w;
+        }
+    }
+
+    float l = luminance(current / max(gbuffer_albedo(gbuffer), vec3(0.01)));
+    vec4 accumulated = vec4(current, 1.0);
+    vec2 moments = vec2(l, l * l);
+    if (frameCount > 1 && weightSum > 0.001)
+    {
+        history /= weightSum;
+        vec3 historyMean = clamp(history.rgb, boxMin, boxMax);
+        float historyCount = min(history.a, float(maxHistoryFrames));
+        accumulated += vec4(historyMean * historyCount, historyCount);
+        moments += historyMoments / weightSum * historyCount;
+    }
+
+    imageStore(accumulationImage, pixel, accumulated);
+    if (accumulateMoments != 0)
+    {
+        imageStore(momentsImage, pixel, vec4(moments, 0.0, 0.0));
+    }
+}
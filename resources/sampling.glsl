@@ -0,0 +1,51 @@
+//Random numbers and sample positions. random_float() advances the global seed, which
+//the kernel sets per pixel and frame before drawing any sample.
+
+uint seed;
+uint wang_hash(uint seed)
+{
+    seed = (seed ^ 61) ^ (seed >> 16);
+    seed *= 9;
+    seed = seed ^ (seed >> 4);
+    seed *= 0x27d4eb2d;
+    seed = seed ^ (seed >> 15);
+    return seed;
+}
+
+float random_float()
+{
+    seed = wang_hash(seed);
+    return float(seed) / 4294967296.0;
+}
+
+vec3 random_unit_vector()
+{
+    float z = random_float() * 2.0 - 1.0;
+    float a = random_float() * 2.0 * 3.1415926;
+    float r = sqrt(1.0 - z * z);
+    return vec3(r * cos(a), r * sin(a), z);
+}
+
+vec3 random_on_hemisphere(vec3 normal)
+{
+    vec3 on_unit_sphere = random_unit_vector();
+    return dot(on_unit_sphere, normal) > 0.0 ? on_unit_sphere : -on_unit_sphere;
+}
+
+vec2 random_in_unit_square()
+{
+    return vec2(random_float(), random_float());
+}
+
+//Anti aliasing: sample i of a pixel lies in cell i % 4 of a 2x2 grid
+vec2 get_subpixel_offset(int sampleIdx)
+{
+    int stratum = sampleIdx % 4;
+    int x = stratum % 2;
+    int y = stratum / 2;
+
+    vec2 stratifiedPos = vec2(x, y) * 0.5;
+    vec2 jitter = random_in_unit_square() * 0.5;
+
+    return stratifiedPos + jitter;
+}
@@ -0,0 +1,172 @@
+#version 430
+layout(local_size_x = 16, local_size_y = 16) in;
+
+//SVGF, wavelet pass: one iteration of the edge-aware a-trous filter with a 5x5 B3 spline
+//kernel whose taps are stepSize pixels apart. Each work group filters a 16x16 lattice of
+//pixels spaced stepSize apart, so every tap of every pixel lies on the same lattice and the
+//whole neighbourhood (lattice plus a two point apron) is staged in shared memory once,
+//regardless of the step size.
+
+layout(rgba32ui, binding = 0) uniform readonly uimage2D gbufferImage;
+layout(rgba16f, binding = 1) uniform readonly image2D illuminationInput;
+layout(rgba16f, binding = 2) uniform writeonly image2D illuminationOutput;
+
+uniform int stepSize;
+//last iteration: re-apply the albedo and write displayable colour with a = 1
+uniform bool finalPass;
+uniform float sigmaLuminance;
+uniform float sigmaNormal;
+uniform float sigmaDepth;
+
+const int TILE = 16;
+const int RADIUS = 2;
+const int SHARED_SIZE = TILE + 2 * RADIUS;
+
+shared vec4 sharedIllumination[SHARED_SIZE * SHARED_SIZE];
+//xyz normal, w depth (negative outside the image)
+shared vec4 sharedGeometry[SHARED_SIZE * SHARED_SIZE];
+
+const float KERNEL[3] = float[3](3.0 / 8.0, 1.0 / 4.0, 1.0 / 16.0);
+
+vec2 sign_not_zero(vec2 v)
+{
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+//G-buffer texel layout, see encode_gbuffer() in raytracer.cs
+vec3 gbuffer_normal(uvec4 g)
+{
+    vec2 e = unpackSnorm2x16(g.x);
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+    {
+        n.xy = (1.0 - abs(n.yx)) * sign_not_zero(n.xy);
+    }
+    return normalize(n);
+}
+
+float gbuffer_depth(uvec4 g)
+{
+    return uintBitsToFloat(g.y);
+}
+
+vec3 gbuffer_albedo(uvec4 g)
+{
+    return unpackUnorm4x8(g.w).rgb;
+}
+
+float luminance(vec3 c)
+{
+    return dot(c, vec3(0.2126, 0.7152, 0.0722));
+}
+
+int sharedIndex(ivec2 local)
+{
+    return (local.y + RADIUS) * SHARED_SIZE + local.x + RADIUS;
+}
+
+void main()
+{
+    ivec2 screenSize = imageSize(illuminationOutput);
+
+    //First lattice point of this work group: the image is split into blocks of
+    //(TILE * stepSize)^2 pixels and each block into stepSize^2 interleaved lattices
+    ivec2 group = ivec2(gl_WorkGroupID.xy);
+    ivec2 origin = (group / stepSize) * TILE * stepSize + group % stepSize;
+
+    for (int i = int(gl_LocalInvocationIndex); i < SHARED_SIZE * SHARED_SIZE; i += TILE * TILE)
+    {
+        ivec2 p = origin + (ivec2(i % SHARED_SIZE, i / SHARED_SIZE) - RADIUS) * stepSize;
+        vec4 illumination = vec4(0.0);
+        vec4 geometry = vec4(0.0, 0.0, 0.0, -1.0);
+        if (p.x >= 0 && p.y >= 0 && p.x < screenSize.x && p.y < screenSize.y)
+        {
+            uvec4 g = imageLoad(gbufferImage, p);
+            illumination = imageLoad(illuminationInput, p);
+            geometry = vec4(gbuffer_normal(g), gbuffer_depth(g));
+        }
+        sharedIllumination[i] = illumination;
+        sharedGeometry[i] = geometry;
+    }
+
+    barrier();
+
+    ivec2 local = ivec2(gl_LocalInvocationID.xy);
+    ivec2 pixel = origin + local * stepSize;
+    if (pixel.x >= screenSize.x || pixel.y >= screenSize.y)
+    {
+        return;
+    }
+
+    vec4 center = sharedIllumination[sharedIndex(local)];
+    vec4 centerGeometry = sharedGeometry[sharedIndex(local)];
+    float centerLuminance = luminance(center.rgb);
+
+    //3x3 gaussian of the variance makes the luminance edge stop robust against its own noise
+    float variance = 0.0;
+    for (int y = -1; y <= 1; y++)
+    {
+        for (int x = -1; x <= 1; x++)
+        {
+            float k = (x == 0 ? 0.5 : 0.25) * (y == 0 ? 0.5 : 0.25);
+            variance += k * sharedIllumination[sharedIndex(local + ivec2(x, y))].a;
+        }
+    }
+
+    //Depth change per pixel, so the depth edge stop tolerates slanted surfaces
+    float depthGradient = 0.0;
+    for (int axis = 0; axis < 2; axis++)
+    {
+        ivec2 offset = axis == 0 ? ivec2(1, 0) : ivec2(0, 1);
+        float a = sharedGeometry[sharedIndex(local + offset)].w;
+        float b = sharedGeometry[sharedIndex(local - offset)].w;
+        if (a >= 0.0 && b >= 0.0)
+        {
+            depthGradient = max(depthGradient, abs(a - b) * 0.5 / float(stepSize));
+        }
+    }
+
+    float luminanceDenominator = sigmaLuminance * sqrt(variance) + 0.0001;
+
+    vec3 illuminationSum = vec3(0.0);
+    float varianceSum = 0.0;
+    float weightSum = 0.0;
+    for (int y = -RADIUS; y <= RADIUS; y++)
+    {
+        for (int x = -RADIUS; x <= RADIUS; x++)
+        {
+            ivec2 q = local + ivec2(x, y);
+            vec4 geometry = sharedGeometry[sharedIndex(q)];
+            if (geometry.w < 0.0)
+            {
+                continue;
+            }
+            vec4 illumination = sharedIllumination[sharedIndex(q)];
+
+            float h = KERNEL[abs(x)] * KERNEL[abs(y)];
+            float wNormal = pow(max(dot(centerGeometry.xyz, geometry.xyz), 0.0), sigmaNormal);
+            float wDepth = abs(centerGeometry.w - geometry.w)
+                         / (sigmaDepth * depthGradient * length(vec2(x, y)) * float(stepSize) + 0.001);
+            float wLuminance = abs(centerLuminance - luminance(illumination.rgb)) / luminanceDenominator;
+            float w = h * wNormal * exp(-wDepth - wLuminance);
+
+            illuminationSum += w * illumination.rgb;
+            varianceSum += w * w * illumination.a;
+            weightSum += w;
+        }
+    }
+
+    //the center tap always contributes with weight KERNEL[0]^2, so weightSum is never zero
+    vec3 filtered = illuminationSum / weightSum;
+    float filteredVariance = varianceSum / (weightSum * weightSum);
+
+    if (finalPass)
+    {
+        vec3 albedo = gbuffer_albedo(imageLoad(gbufferImage, pixel));
+        imageStore(illuminationOutput, pixel, vec4(filtered * max(albedo, vec3(0.01)), 1.0));
+    }
+    else
+    {
+        imageStore(illuminationOutput, pixel, vec4(filtered, filteredVariance));
+    }
+}
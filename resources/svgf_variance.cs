@@ -0,0 +1,102 @@
+#version 430
+layout(local_size_x = 16, local_size_y = 16) in;
+
+//SVGF, first pass: demodulates the accumulated colour by the primary hit albedo and estimates
+//the variance of its luminance from the temporally accumulated moments. Pixels with a short
+//history (just disoccluded or after a reset) fall back to a spatial estimate.
+
+layout(rgba32ui, binding = 0) uniform readonly uimage2D gbufferImage;
+layout(rgba32f, binding = 1) uniform readonly image2D accumulationImage;
+layout(rg32f, binding = 6) uniform readonly image2D momentsImage;
+//rgb demodulated illumination, a variance of its luminance mean
+layout(rgba16f, binding = 2) uniform writeonly image2D illuminationOutput;
+
+//History length below which the temporal moments are too noisy to use on their own
+const float MIN_HISTORY = 4.0;
+const int SPATIAL_RADIUS = 2;
+
+vec2 sign_not_zero(vec2 v)
+{
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+//G-buffer texel layout, see encode_gbuffer() in raytracer.cs
+vec3 gbuffer_normal(uvec4 g)
+{
+    vec2 e = unpackSnorm2x16(g.x);
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+    {
+        n.xy = (1.0 - abs(n.yx)) * sign_not_zero(n.xy);
+    }
+    return normalize(n);
+}
+
+float gbuffer_depth(uvec4 g)
+{
+    return uintBitsToFloat(g.y);
+}
+
+vec3 gbuffer_albedo(uvec4 g)
+{
+    return unpackUnorm4x8(g.w).rgb;
+}
+
+float luminance(vec3 c)
+{
+    return dot(c, vec3(0.2126, 0.7152, 0.0722));
+}
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 screenSize = imageSize(illuminationOutput);
+
+    if (pixel.x >= screenSize.x || pixel.y >= screenSize.y)
+    {
+        return;
+    }
+
+    uvec4 g = imageLoad(gbufferImage, pixel);
+    vec4 accumulated = imageLoad(accumulationImage, pixel);
+    float count = max(accumulated.a, 1.0);
+    vec3 illumination = accumulated.rgb / count / max(gbuffer_albedo(g), vec3(0.01));
+    vec2 moments = imageLoad(momentsImage, pixel).rg / count;
+
+    if (count < MIN_HISTORY)
+    {
+        //Edge-aware spatial estimate of the moments over the neighbourhood
+        vec3 normal = gbuffer_normal(g);
+        float depth = gbuffer_depth(g);
+        vec2 spatialMoments = vec2(0.0);
+        float weightSum = 0.0;
+        for (int y = -SPATIAL_RADIUS; y <= SPATIAL_RADIUS; y++)
+        {
+            for (int x = -SPATIAL_RADIUS; x <= SPATIAL_RADIUS; x++)
+            {
+                ivec2 q = pixel + ivec2(x, y);
+                if (q.x < 0 || q.y < 0 || q.x >= screenSize.x || q.y >= screenSize.y)
+                {
+                    continue;
+                }
+
+                uvec4 gq = imageLoad(gbufferImage, q);
+                float w = pow(max(dot(normal, gbuffer_normal(gq)), 0.0), 128.0)
+                        * exp(-abs(depth - gbuffer_depth(gq)) / (0.05 * depth + 0.001));
+                float countQ = max(imageLoad(accumulationImage, q).a, 1.0);
+                spatialMoments += w * imageLoad(momentsImage, q).rg / countQ;
+                weightSum += w;
+            }
+        }
+        moments = spatialMoments / max(weightSum, 0.0001);
+    }
+
+    //Variance of a single frame's luminance, then of the accumulated mean
+    float variance = max(moments.y - moments.x * moments.x, 0.0);
+    if (count < MIN_HISTORY)
+    {
+        variance *= MIN_HISTORY / count;
+    }
+
+    imageStore(illuminationOutput, pixel, vec4(illumination, variance / count));
+}
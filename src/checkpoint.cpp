@@ -0,0 +1,190 @@
+#include "Checkpoint.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+static const char CHECKPOINT_MAGIC[4] = { 'R', 'T', 'C', 'K' };
+static const uint32_t CHECKPOINT_VERSION = 2;
+
+enum CheckpointFlags : uint32_t {
+    CHECKPOINT_HAS_MOMENTS = 1,
+    CHECKPOINT_PER_PIXEL_COUNTS = 2,
+};
+
+struct CheckpointHeader
+{
+    char magic[4];
+    uint32_t version;
+    int32_t width;
+    int32_t height;
+    int32_t view;
+    uint32_t firstFrame;
+    uint32_t frameCount;
+    uint32_t flags;
+};
+
+bool saveCheckpoint(const std::string& path, const Checkpoint& checkpoint)
+{
+    size_t pixelCount = size_t(checkpoint.width) * checkpoint.height;
+
+    CheckpointHeader header = {};
+    std::copy(CHECKPOINT_MAGIC, CHECKPOINT_MAGIC + 4, header.magic);
+    header.version = CHECKPOINT_VERSION;
+    header.width = checkpoint.width;
+    header.height = checkpoint.height;
+    header.view = checkpoint.view;
+    header.firstFrame = checkpoint.firstFrame;
+    header.frameCount = checkpoint.frameCount;
+    header.flags = checkpoint.moments.empty() ? 0u : uint32_t(CHECKPOINT_HAS_MOMENTS);
+    for (size_t i = 0; i < pixelCount; i++) {
+        if (checkpoint.accumulation[i * 4 + 3] != (float)checkpoint.frameCount) {
+            header.flags |= CHECKPOINT_PER_PIXEL_COUNTS;
+            break;
+        }
+    }
+
+    std::string temporary = path + ".tmp";
+    FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (!file) {
+        std::cout << "Failed to open " << temporary << " for writing\n";
+        return false;
+    }
+
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+    if (header.flags & CHECKPOINT_PER_PIXEL_COUNTS) {
+        ok = ok && std::fwrite(checkpoint.accumulation.data(), sizeof(float) * 4, pixelCount, file) == pixelCount;
+    }
+    else {
+        // 12 instead of 16 bytes per pixel, written in rows to keep the copy small
+        std::vector<float> row(size_t(checkpoint.width) * 3);
+        for (int y = 0; y < checkpoint.height && ok; y++) {
+            const float* src = &checkpoint.accumulation[size_t(y) * checkpoint.width * 4];
+            for (int x = 0; x < checkpoint.width; x++) {
+                row[x * 3 + 0] = src[x * 4 + 0];
+                row[x * 3 + 1] = src[x * 4 + 1];
+                row[x * 3 + 2] = src[x * 4 + 2];
+            }
+            ok = std::fwrite(row.data(), sizeof(float), row.size(), file) == row.size();
+        }
+    }
+    if (header.flags & CHECKPOINT_HAS_MOMENTS) {
+        ok = ok && std::fwrite(checkpoint.moments.data(), sizeof(float) * 2, pixelCount, file) == pixelCount;
+    }
+    ok = std::fclose(file) == 0 && ok;
+
+#ifdef _WIN32
+    // rename does not replace existing files on Windows
+    if (ok) {
+        std::remove(path.c_str());
+    }
+#endif
+    ok = ok && std::rename(temporary.c_str(), path.c_str()) == 0;
+    if (!ok) {
+        std::cout << "Failed to write checkpoint " << path << "\n";
+        std::remove(temporary.c_str());
+    }
+    return ok;
+}
+
+bool loadCheckpoint(const std::string& path, Checkpoint& checkpoint, bool headerOnly)
+{
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        std::cout << "No checkpoint at " << path << "\n";
+        return false;
+    }
+
+    CheckpointHeader header;
+    bool ok = std::fread(&header, sizeof(header), 1, file) == 1
+        && std::equal(CHECKPOINT_MAGIC, CHECKPOINT_MAGIC + 4, header.magic)
+        && header.version == CHECKPOINT_VERSION
+        && header.width > 0 && header.height > 0
+        && (header.flags & ~uint32_t(CHECKPOINT_HAS_MOMENTS | CHECKPOINT_PER_PIXEL_COUNTS)) == 0;
+    if (!ok) {
+        std::cout << path << " is not a checkpoint this build can read\n";
+        std::fclose(file);
+        return false;
+    }
+
+    // --merge takes any file, a corrupt header must not turn into a huge allocation: the
+    // pixels are the rest of the file
+    size_t pixelCount = size_t(header.width) * header.height;
+    uint64_t pixelSize = ((header.flags & CHECKPOINT_PER_PIXEL_COUNTS) ? 16 : 12)
+        + ((header.flags & CHECKPOINT_HAS_MOMENTS) ? 8 : 0);
+    long start = std::ftell(file);
+    ok = std::fseek(file, 0, SEEK_END) == 0 && start >= 0;
+    long end = ok ? std::ftell(file) : -1;
+    ok = ok && end >= start
+        && (uint64_t)(end - start) % pixelSize == 0
+        && (uint64_t)(end - start) / pixelSize == (uint64_t)pixelCount
+        && std::fseek(file, start, SEEK_SET) == 0;
+    if (!ok) {
+        std::cout << "Checkpoint " << path << " does not match its " << header.width << "x" << header.height << " header\n";
+        std::fclose(file);
+        return false;
+    }
+
+    checkpoint.width = header.width;
+    checkpoint.height = header.height;
+    checkpoint.view = header.view;
+    checkpoint.firstFrame = header.firstFrame;
+    checkpoint.frameCount = header.frameCount;
+    checkpoint.accumulation.clear();
+    checkpoint.moments.clear();
+    if (headerOnly) {
+        std::fclose(file);
+        return true;
+    }
+
+    checkpoint.accumulation.resize(pixelCount * 4);
+    if (header.flags & CHECKPOINT_PER_PIXEL_COUNTS) {
+        ok = std::fread(checkpoint.accumulation.data(), sizeof(float) * 4, pixelCount, file) == pixelCount;
+    }
+    else {
+        std::vector<float> row(size_t(header.width) * 3);
+        for (int y = 0; y < header.height && ok; y++) {
+            ok = std::fread(row.data(), sizeof(float), row.size(), file) == row.size();
+            float* dst = &checkpoint.accumulation[size_t(y) * header.width * 4];
+            for (int x = 0; x < header.width; x++) {
+                dst[x * 4 + 0] = row[x * 3 + 0];
+                dst[x * 4 + 1] = row[x * 3 + 1];
+                dst[x * 4 + 2] = row[x * 3 + 2];
+                dst[x * 4 + 3] = (float)header.frameCount;
+            }
+        }
+    }
+
+    if (ok && (header.flags & CHECKPOINT_HAS_MOMENTS)) {
+        checkpoint.moments.resize(pixelCount * 2);
+        ok = std::fread(checkpoint.moments.data(), sizeof(float) * 2, pixelCount, file) == pixelCount;
+    }
+    std::fclose(file);
+
+    if (!ok) {
+        std::cout << "Checkpoint " << path << " is truncated\n";
+    }
+    return ok;
+}
+
+void CheckpointWriter::save(const std::string& path, Checkpoint&& checkpoint)
+{
+    wait();
+    pending = std::async(std::launch::async, [path, checkpoint = std::move(checkpoint)]() {
+        return saveCheckpoint(path, checkpoint);
+    });
+}
+
+bool CheckpointWriter::wait()
+{
+    if (pending.valid()) {
+        ok = pending.get() && ok;
+    }
+    return ok;
+}
+
+bool CheckpointWriter::busy() const
+{
+    return pending.valid() && pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+}
@@ -0,0 +1,332 @@
+#include <CpuDenoiser.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CPU_DENOISER_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CPU_DENOISER_AVX2_TARGET
+#else
+#define CPU_DENOISER_AVX2_TARGET __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+namespace
+{
+
+const float KERNEL[3] = {3.f / 8.f, 1.f / 4.f, 1.f / 16.f};
+
+// Planar (one array per channel) copy of the AOVs, so 8 neighbouring pixels of a channel
+// are one unaligned vector load
+struct Planes
+{
+	int width = 0;
+	int height = 0;
+	std::vector<float> color[3];
+	std::vector<float> albedo[3];
+	std::vector<float> normal[3];
+	std::vector<float> depth;
+};
+
+struct PassParams
+{
+	int step;
+	float invSigmaColor2;
+	float invSigmaNormal2;
+	float invSigmaDepth;
+	float invSigmaAlbedo2;
+};
+
+// Filters pixels [x0, x1) of row y one at a time, used on image borders and without AVX2
+void filterScalar(const Planes &p, const std::vector<float> *in, std::vector<float> *out,
+	int y, int x0, int x1, const PassParams &params)
+{
+	for (int x = x0; x < x1; x++)
+	{
+		int i = y * p.width + x;
+		float c[3] = {in[0][i], in[1][i], in[2][i]};
+		float n[3] = {p.normal[0][i], p.normal[1][i], p.normal[2][i]};
+		float a[3] = {p.albedo[0][i], p.albedo[1][i], p.albedo[2][i]};
+		float depthScale = params.invSigmaDepth / std::max(p.depth[i], 0.0001f);
+
+		float sum[3] = {};
+		float weightSum = 0.f;
+		for (int dy = -2; dy <= 2; dy++)
+		{
+			int qy = y + dy * params.step;
+			if (qy < 0 || qy >= p.height) { continue; }
+			for (int dx = -2; dx <= 2; dx++)
+			{
+				int qx = x + dx * params.step;
+				if (qx < 0 || qx >= p.width) { continue; }
+				int q = qy * p.width + qx;
+
+				float dc = 0.f, dn = 0.f, da = 0.f;
+				for (int k = 0; k < 3; k++)
+				{
+					float t = in[k][q] - c[k]; dc += t * t;
+					t = p.normal[k][q] - n[k]; dn += t * t;
+					t = p.albedo[k][q] - a[k]; da += t * t;
+				}
+				float dz = (p.depth[q] - p.depth[i]) * depthScale;
+
+				float w = KERNEL[std::abs(dx)] * KERNEL[std::abs(dy)] * std::exp(-(dc * params.invSigmaColor2
+					+ dn * params.invSigmaNormal2 + dz * dz + da * params.invSigmaAlbedo2));
+				for (int k = 0; k < 3; k++) { sum[k] += w * in[k][q]; }
+				weightSum += w;
+			}
+		}
+
+		for (int k = 0; k < 3; k++) { out[k][i] = sum[k] / weightSum; }
+	}
+}
+
+#ifdef CPU_DENOISER_X86
+
+bool cpuHasAvx2()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) { return false; }
+	__cpuidex(info, 7, 0);
+	bool avx2 = (info[1] & (1 << 5)) != 0;
+	__cpuid(info, 1);
+	bool fma = (info[2] & (1 << 12)) != 0;
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	return avx2 && fma && osxsave && (_xgetbv(0) & 6) == 6;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+
+// exp(x) for x <= 0: 2^(x * log2(e)) split into an integer power built in the exponent bits
+// and a polynomial for the fraction, accurate to a few ulp which is plenty for filter weights
+CPU_DENOISER_AVX2_TARGET inline __m256 exp256(__m256 x)
+{
+	x = _mm256_max_ps(x, _mm256_set1_ps(-87.f));
+	__m256 t = _mm256_mul_ps(x, _mm256_set1_ps(1.44269504f));
+	__m256 n = _mm256_floor_ps(t);
+	__m256 f = _mm256_sub_ps(t, n);
+
+	__m256 poly = _mm256_set1_ps(0.001333355f);
+	poly = _mm256_fmadd_ps(poly, f, _mm256_set1_ps(0.009618129f));
+	poly = _mm256_fmadd_ps(poly, f, _mm256_set1_ps(0.05550411f));
+	poly = _mm256_fmadd_ps(poly, f, _mm256_set1_ps(0.2402265f));
+	poly = _mm256_fmadd_ps(poly, f, _mm256_set1_ps(0.6931472f));
+	poly = _mm256_fmadd_ps(poly, f, _mm256_set1_ps(1.f));
+
+	__m256i exponent = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+	return _mm256_mul_ps(poly, _mm256_castsi256_ps(exponent));
+}
+
+// Filters 8 pixels starting at (x, y); all 25 taps of all 8 pixels must be inside the image
+CPU_DENOISER_AVX2_TARGET void filterAvx2(const Planes &p, const std::vector<float> *in, std::vector<float> *out,
+	int y, int x, const PassParams &params)
+{
+	// raw channel pointers, the vectors' data() would otherwise be reloaded after every store
+	const float *inPtr[3], *normalPtr[3], *albedoPtr[3];
+	for (int k = 0; k < 3; k++)
+	{
+		inPtr[k] = in[k].data();
+		normalPtr[k] = p.normal[k].data();
+		albedoPtr[k] = p.albedo[k].data();
+	}
+	const float *depthPtr = p.depth.data();
+
+	int i = y * p.width + x;
+	__m256 c[3], n[3], a[3];
+	for (int k = 0; k < 3; k++)
+	{
+		c[k] = _mm256_loadu_ps(inPtr[k] + i);
+		n[k] = _mm256_loadu_ps(normalPtr[k] + i);
+		a[k] = _mm256_loadu_ps(albedoPtr[k] + i);
+	}
+	__m256 depth = _mm256_loadu_ps(depthPtr + i);
+	__m256 depthScale = _mm256_div_ps(_mm256_set1_ps(params.invSigmaDepth),
+		_mm256_max_ps(depth, _mm256_set1_ps(0.0001f)));
+
+	const __m256 invSigmaColor2 = _mm256_set1_ps(params.invSigmaColor2);
+	const __m256 invSigmaNormal2 = _mm256_set1_ps(params.invSigmaNormal2);
+	const __m256 invSigmaAlbedo2 = _mm256_set1_ps(params.invSigmaAlbedo2);
+	const __m256 signMask = _mm256_set1_ps(-0.f);
+
+	__m256 sum[3] = {_mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps()};
+	__m256 weightSum = _mm256_setzero_ps();
+	for (int dy = -2; dy <= 2; dy++)
+	{
+		for (int dx = -2; dx <= 2; dx++)
+		{
+			int q = i + dy * params.step * p.width + dx * params.step;
+
+			__m256 qc[3];
+			__m256 dc = _mm256_setzero_ps(), dn = _mm256_setzero_ps(), da = _mm256_setzero_ps();
+			for (int k = 0; k < 3; k++)
+			{
+				qc[k] = _mm256_loadu_ps(inPtr[k] + q);
+				__m256 t = _mm256_sub_ps(qc[k], c[k]);
+				dc = _mm256_fmadd_ps(t, t, dc);
+				t = _mm256_sub_ps(_mm256_loadu_ps(normalPtr[k] + q), n[k]);
+				dn = _mm256_fmadd_ps(t, t, dn);
+				t = _mm256_sub_ps(_mm256_loadu_ps(albedoPtr[k] + q), a[k]);
+				da = _mm256_fmadd_ps(t, t, da);
+			}
+			__m256 dz = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(depthPtr + q), depth), depthScale);
+
+			__m256 e = _mm256_mul_ps(dc, invSigmaColor2);
+			e = _mm256_fmadd_ps(dn, invSigmaNormal2, e);
+			e = _mm256_fmadd_ps(dz, dz, e);
+			e = _mm256_fmadd_ps(da, invSigmaAlbedo2, e);
+			__m256 w = _mm256_mul_ps(_mm256_set1_ps(KERNEL[std::abs(dx)] * KERNEL[std::abs(dy)]),
+				exp256(_mm256_xor_ps(e, signMask)));
+
+			for (int k = 0; k < 3; k++) { sum[k] = _mm256_fmadd_ps(w, qc[k], sum[k]); }
+			weightSum = _mm256_add_ps(weightSum, w);
+		}
+	}
+
+	for (int k = 0; k < 3; k++) { _mm256_storeu_ps(&out[k][i], _mm256_div_ps(sum[k], weightSum)); }
+}
+
+#endif
+
+// One a-trous iteration over a tile, rows whose taps stay inside the image take the vector path
+void filterTile(const Planes &p, const std::vector<float> *in, std::vector<float> *out,
+	int tileX, int tileY, int tileSize, const PassParams &params, bool avx2)
+{
+	int x0 = tileX * tileSize, x1 = std::min(x0 + tileSize, p.width);
+	int y0 = tileY * tileSize, y1 = std::min(y0 + tileSize, p.height);
+	int apron = 2 * params.step;
+
+	for (int y = y0; y < y1; y++)
+	{
+		int x = x0;
+#ifdef CPU_DENOISER_X86
+		if (avx2 && y >= apron && y + apron < p.height)
+		{
+			int vectorBegin = std::min(std::max(x0, apron), x1);
+			int vectorEnd = std::max(std::min(x1, p.width - apron), vectorBegin);
+			filterScalar(p, in, out, y, x0, vectorBegin, params);
+			for (x = vectorBegin; x + 8 <= vectorEnd; x += 8)
+			{
+				filterAvx2(p, in, out, y, x, params);
+			}
+		}
+#endif
+		filterScalar(p, in, out, y, x, x1, params);
+	}
+}
+
+}
+
+CpuDenoiser::CpuDenoiser(const CpuDenoiserSettings &settings)
+	: settings(settings)
+{
+#ifdef CPU_DENOISER_X86
+	avx2 = cpuHasAvx2();
+#endif
+}
+
+void CpuDenoiser::denoise(const CpuAovs &aovs, std::vector<float> &output)
+{
+	const int width = aovs.width, height = aovs.height;
+	const size_t pixelCount = size_t(width) * height;
+
+	// Demodulate and split into planes
+	Planes p;
+	p.width = width;
+	p.height = height;
+	std::vector<float> scratch[3];
+	for (int k = 0; k < 3; k++)
+	{
+		p.color[k].resize(pixelCount);
+		p.albedo[k].resize(pixelCount);
+		p.normal[k].resize(pixelCount);
+		scratch[k].resize(pixelCount);
+	}
+	p.depth = aovs.depth;
+	for (size_t i = 0; i < pixelCount; i++)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			float albedo = aovs.albedo[i * 3 + k];
+			p.albedo[k][i] = albedo;
+			p.normal[k][i] = aovs.normal[i * 3 + k];
+			p.color[k][i] = aovs.color[i * 3 + k] / std::max(albedo, 0.01f);
+		}
+	}
+
+	unsigned int threadCount = settings.threads ? settings.threads : std::thread::hardware_concurrency();
+	threadCount = std::max(threadCount, 1u);
+	const int tileSize = std::max(settings.tileSize, 8);
+	const int tilesX = (width + tileSize - 1) / tileSize;
+	const int tilesY = (height + tileSize - 1) / tileSize;
+	const int tileCount = tilesX * tilesY;
+
+	// Every iteration's parameters up front, the workers run all of them
+	const int iterations = std::max(settings.iterations, 0);
+	std::vector<PassParams> passes(iterations);
+	float sigmaColor = settings.sigmaColor;
+	for (int iteration = 0; iteration < iterations; iteration++)
+	{
+		PassParams &params = passes[iteration];
+		params.step = 1 << iteration;
+		params.invSigmaColor2 = 1.f / (sigmaColor * sigmaColor);
+		params.invSigmaNormal2 = 1.f / (settings.sigmaNormal * settings.sigmaNormal);
+		params.invSigmaDepth = 1.f / settings.sigmaDepth;
+		params.invSigmaAlbedo2 = 1.f / (settings.sigmaAlbedo * settings.sigmaAlbedo);
+		sigmaColor *= 0.5f;
+	}
+
+	// The threads are started once and pull (iteration, tile) items until none are left.
+	// A tile of an iteration waits until every tile of the previous one is finished, as its
+	// taps read their output.
+	std::vector<float> *buffers[2] = { p.color, scratch };
+	const int workCount = iterations * tileCount;
+	std::atomic<int> nextWork(0);
+	std::atomic<int> finishedTiles(0);
+	std::mutex mutex;
+	std::condition_variable iterationDone;
+	auto worker = [&]()
+	{
+		for (int work = nextWork++; work < workCount; work = nextWork++)
+		{
+			const int iteration = work / tileCount, tile = work % tileCount;
+			if (finishedTiles < iteration * tileCount)
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				iterationDone.wait(lock, [&] { return finishedTiles >= iteration * tileCount; });
+			}
+			filterTile(p, buffers[iteration % 2], buffers[1 - iteration % 2], tile % tilesX, tile / tilesX, tileSize,
+				passes[iteration], avx2);
+			if (++finishedTiles % tileCount == 0)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				iterationDone.notify_all();
+			}
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (unsigned int t = 1; t < threadCount && workCount > 0; t++) { workers.emplace_back(worker); }
+	worker();
+	for (auto &t : workers) { t.join(); }
+	std::vector<float> *in = buffers[iterations % 2];
+
+	// Re-modulate
+	output.resize(pixelCount * 3);
+	for (size_t i = 0; i < pixelCount; i++)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			output[i * 3 + k] = in[k][i] * std::max(p.albedo[k][i], 0.01f);
+		}
+	}
+}
@@ -1,4 +1,5 @@
 #include <demoShaderLoader.h>
+#include <ProgramCache.h>
 #include <iostream>
 #include <fstream>
 
@@ -48,15 +49,14 @@ GLint createShaderFromData(const char *data, GLenum shaderType, const char *path
 }
 
 
-GLint createShaderFromFile(const char *name, GLenum shaderType)
+static bool readShaderFile(const char *name, std::string &str)
 {
 	std::ifstream f(name);
-	std::string str;
 
 	if (!f.is_open())
 	{
 		std::cout << "Error opening file: " + std::string(name) << "\n";
-		return 0;
+		return false;
 	}
 
 	f.seekg(0, std::ios::end);
@@ -66,88 +66,61 @@ GLint createShaderFromFile(const char *name, GLenum shaderType)
 	if (str.capacity() <= 0) 
 	{
 		std::cout << "Error opening file: " + std::string(name) << "\n";
-		return 0; 
+		return false; 
 	}
 
 	str.assign((std::istreambuf_iterator<char>(f)),
 		std::istreambuf_iterator<char>());
 
+	return true;
+}
+
+GLint createShaderFromFile(const char *name, GLenum shaderType)
+{
+	std::string str;
+	if (!readShaderFile(name, str))
+	{
+		return 0;
+	}
 	
 	auto rez = createShaderFromData(str.c_str(), shaderType, name);
 
 	return rez;
 }
 
-bool Shader::loadShaderProgramFromData(const char *vertexShaderData, const char *fragmentShaderData)
+//Links count stages into a program, or takes it from the program binary cache when the
+//sources and driver did not change. paths may be null, they are used for error reporting
+static GLuint buildProgram(int count, const GLenum *types, const char *const *sources, const char *const *paths)
 {
-	auto vertexId = createShaderFromData(vertexShaderData, GL_VERTEX_SHADER);
-	auto fragmentId = createShaderFromData(fragmentShaderData, GL_FRAGMENT_SHADER);
-
-	if (vertexId == 0 || fragmentId == 0)
+	uint64_t cacheKey = programCacheKey(count, types, sources);
+	GLuint id = loadCachedProgram(cacheKey);
+	if (id)
 	{
-		return 0;
+		return id;
 	}
 
-	id = glCreateProgram();
-
-	glAttachShader(id, vertexId);
-	glAttachShader(id, fragmentId);
-
-	glLinkProgram(id);
-
-	glDeleteShader(vertexId);
-	glDeleteShader(fragmentId);
-
-	GLint info = 0;
-	glGetProgramiv(id, GL_LINK_STATUS, &info);
-
-	if (info != GL_TRUE)
+	GLuint shaders[3] = {};
+	bool compiled = true;
+	for (int i = 0; i < count; i++)
 	{
-		char *message = 0;
-		int   l = 0;
-
-		glGetProgramiv(id, GL_INFO_LOG_LENGTH, &l);
-
-		message = new char[l];
-
-		glGetProgramInfoLog(id, l, &l, message);
-
-		std::cout << std::string("Link error: ") + message << "\n";
-
-		delete[] message;
-
-		glDeleteProgram(id);
-		id = 0;
-		return 0;
+		shaders[i] = createShaderFromData(sources[i], types[i], paths ? paths[i] : 0);
+		compiled = compiled && shaders[i] != 0;
 	}
 
-	glValidateProgram(id);
-
-	return true;
-}
-
-bool Shader::loadShaderProgramFromData(const char *vertexShaderData, const char *geometryShaderData, const char *fragmentShaderData)
-{
-	auto vertexId = createShaderFromData(vertexShaderData, GL_VERTEX_SHADER);
-	auto geometryId = createShaderFromData(geometryShaderData, GL_GEOMETRY_SHADER);
-	auto fragmentId = createShaderFromData(fragmentShaderData, GL_FRAGMENT_SHADER);
-
-	if (vertexId == 0 || fragmentId == 0 || geometryId == 0)
+	if (!compiled)
 	{
+		for (int i = 0; i < count; i++) { glDeleteShader(shaders[i]); }
 		return 0;
 	}
 
 	id = glCreateProgram();
 
-	glAttachShader(id, vertexId);
-	glAttachShader(id, geometryId);
-	glAttachShader(id, fragmentId);
+	for (int i = 0; i < count; i++) { glAttachShader(id, shaders[i]); }
 
+	glProgramParameteri(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	glLinkProgram(id);
 
-	glDeleteShader(vertexId);
-	glDeleteShader(geometryId);
-	glDeleteShader(fragmentId);
+	for (int i = 0; i < count; i++) { glDeleteShader(shaders[i]); }
 
 	GLint info = 0;
 	glGetProgramiv(id, GL_LINK_STATUS, &info);
@@ -168,114 +141,69 @@ bool Shader::loadShaderProgramFromData(const char *vertexShaderData, const char
 		delete[] message;
 
 		glDeleteProgram(id);
-		id = 0;
 		return 0;
 	}
 
 	glValidateProgram(id);
 
-	return true;
+	storeCachedProgram(cacheKey, id);
+
+	return id;
 }
 
-bool Shader::loadShaderProgramFromFile(const char *vertexShader, const char *fragmentShader)
+bool Shader::loadShaderProgramFromData(const char *vertexShaderData, const char *fragmentShaderData)
 {
+	const GLenum types[] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+	const char *sources[] = { vertexShaderData, fragmentShaderData };
 
-	auto vertexId = createShaderFromFile(vertexShader, GL_VERTEX_SHADER);
-	auto fragmentId = createShaderFromFile(fragmentShader, GL_FRAGMENT_SHADER);
-
-
-	if (vertexId == 0 || fragmentId == 0)
-	{
-		return 0;
-	}
-
-	id = glCreateProgram();
-
-	glAttachShader(id, vertexId);
-	glAttachShader(id, fragmentId);
-
-	glLinkProgram(id);
+	id = buildProgram(2, types, sources, nullptr);
+	reflection.reflect(id);
+	return id != 0;
+}
 
-	glDeleteShader(vertexId);
-	glDeleteShader(fragmentId);
+bool Shader::loadShaderProgramFromData(const char *vertexShaderData, const char *geometryShaderData, const char *fragmentShaderData)
+{
+	const GLenum types[] = { GL_VERTEX_SHADER, GL_GEOMETRY_SHADER, GL_FRAGMENT_SHADER };
+	const char *sources[] = { vertexShaderData, geometryShaderData, fragmentShaderData };
 
-	GLint info = 0;
-	glGetProgramiv(id, GL_LINK_STATUS, &info);
+	id = buildProgram(3, types, sources, nullptr);
+	reflection.reflect(id);
+	return id != 0;
+}
 
-	if (info != GL_TRUE)
+bool Shader::loadShaderProgramFromFile(const char *vertexShader, const char *fragmentShader)
+{
+	std::string vertexData, fragmentData;
+	if (!readShaderFile(vertexShader, vertexData) || !readShaderFile(fragmentShader, fragmentData))
 	{
-		char *message = 0;
-		int   l = 0;
-
-		glGetProgramiv(id, GL_INFO_LOG_LENGTH, &l);
-
-		message = new char[l];
-
-		glGetProgramInfoLog(id, l, &l, message);
-
-		std::cout << std::string("Link error: ") + message << "\n";
-
-		delete[] message;
-
-		glDeleteProgram(id);
-		id = 0;
 		return 0;
 	}
 
-	glValidateProgram(id);
+	const GLenum types[] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+	const char *sources[] = { vertexData.c_str(), fragmentData.c_str() };
+	const char *paths[] = { vertexShader, fragmentShader };
 
-	return true;
+	id = buildProgram(2, types, sources, paths);
+	reflection.reflect(id);
+	return id != 0;
 }
 
 bool Shader::loadShaderProgramFromFile(const char *vertexShader, const char *geometryShader, const char *fragmentShader)
 {
-	auto vertexId = createShaderFromFile(vertexShader, GL_VERTEX_SHADER);
-	auto geometryId = createShaderFromFile(geometryShader, GL_GEOMETRY_SHADER);
-	auto fragmentId = createShaderFromFile(fragmentShader, GL_FRAGMENT_SHADER);
-
-	if (vertexId == 0 || fragmentId == 0 || geometryId == 0)
+	std::string vertexData, geometryData, fragmentData;
+	if (!readShaderFile(vertexShader, vertexData) || !readShaderFile(geometryShader, geometryData)
+		|| !readShaderFile(fragmentShader, fragmentData))
 	{
 		return 0;
 	}
 
-	id = glCreateProgram();
-
-	glAttachShader(id, vertexId);
-	glAttachShader(id, geometryId);
-	glAttachShader(id, fragmentId);
+	const GLenum types[] = { GL_VERTEX_SHADER, GL_GEOMETRY_SHADER, GL_FRAGMENT_SHADER };
+	const char *sources[] = { vertexData.c_str(), geometryData.c_str(), fragmentData.c_str() };
+	const char *paths[] = { vertexShader, geometryShader, fragmentShader };
 
-	glLinkProgram(id);
-
-	glDeleteShader(vertexId);
-	glDeleteShader(geometryId);
-	glDeleteShader(fragmentId);
-
-	GLint info = 0;
-	glGetProgramiv(id, GL_LINK_STATUS, &info);
-
-	if (info != GL_TRUE)
-	{
-		char *message = 0;
-		int   l = 0;
-
-		glGetProgramiv(id, GL_INFO_LOG_LENGTH, &l);
-
-		message = new char[l];
-
-		glGetProgramInfoLog(id, l, &l, message);
-
-		std::cout << std::string("Link error: ") + message << "\n";
-
-		delete[] message;
-
-		glDeleteProgram(id);
-		id = 0;
-		return 0;
-	}
-
-	glValidateProgram(id);
-
-	return true;
+	id = buildProgram(3, types, sources, paths);
+	reflection.reflect(id);
+	return id != 0;
 }
 
 void Shader::use()
@@ -287,11 +215,17 @@ void Shader::clear()
 {
 	glDeleteProgram(id);
 	id = 0;
+	reflection.reflect(0);
 }
 
 GLint Shader::getUniform(const char *name)
 {
-	return ::getUniform(this->id, name);
+	GLint uniform = reflection.uniformLocation(name);
+	if (uniform == -1)
+	{
+		std::cout << "uniform error " + std::string(name);
+	}
+	return uniform;
 }
 
 GLint getUniform(GLuint shaderId, const char *name)
@@ -304,27 +238,39 @@ GLint getUniform(GLuint shaderId, const char *name)
 	return uniform;
 }
 
-void Shader::setBool(const std::string& name, bool value) const
+void Shader::setBool(const char *name, bool value) const
+{
+	glUniform1i(reflection.uniformLocation(name), (int)value);
+}
+void Shader::setInt(const char *name, int value) const
+{
+	glUniform1i(reflection.uniformLocation(name), value);
+}
+void Shader::setInt(UniformHandle uniform, int value) const
+{
+	glUniform1i(reflection.location(uniform), value);
+}
+void Shader::setFloat(const char *name, float value) const
 {
-	glUniform1i(glGetUniformLocation(id, name.c_str()), (int)value);
+	glUniform1f(reflection.uniformLocation(name), value);
 }
-void Shader::setInt(const std::string& name, int value) const
+void Shader::setFloat(UniformHandle uniform, float value) const
 {
-	glUniform1i(glGetUniformLocation(id, name.c_str()), value);
+	glUniform1f(reflection.location(uniform), value);
 }
-void Shader::setFloat(const std::string& name, float value) const
+void Shader::setVec4f(const char *name, float x, float y, float z, float w) const
 {
-	glUniform1f(glGetUniformLocation(id, name.c_str()), value);
+	glUniform4f(reflection.uniformLocation(name), x, y, z, w);
 }
-void Shader::setVec4f(const std::string& name, float x, float y, float z, float w) const
+void Shader::setVec3(const char *name, float x, float y, float z) const
 {
-	glUniform4f(glGetUniformLocation(id, name.c_str()), x, y, z, w);
+	glUniform3f(reflection.uniformLocation(name), x, y, z);
 }
-void Shader::setVec3(const std::string& name, float x, float y, float z) const
+void Shader::setMat4(const char *name, const glm::mat4& mat)const
 {
-	glUniform3f(glGetUniformLocation(id, name.c_str()), x, y, z);
+	glUniformMatrix4fv(reflection.uniformLocation(name), 1, GL_FALSE, &mat[0][0]);
 }
-void Shader::setMat4(const std::string& name, const glm::mat4& mat)const
+void Shader::setMat4(UniformHandle uniform, const glm::mat4& mat)const
 {
-	glUniformMatrix4fv(id, 1, GL_FALSE, &mat[0][0]);
-}
\ No newline at end of file
+	glUniformMatrix4fv(reflection.location(uniform), 1, GL_FALSE, &mat[0][0]);
+}
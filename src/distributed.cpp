@@ -0,0 +1,306 @@
+#include "Distributed.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "FramePacer.h"
+#include "HeadlessContext.h"
+#include "Renderer.h"
+#include "Socket.h"
+
+// Messages are a header followed by size bytes of payload. Everything is sent in native byte
+// order, coordinator and workers are expected to run the same build.
+static const uint32_t PROTOCOL_VERSION = 3;
+
+enum MessageType : uint32_t {
+    MESSAGE_HELLO = 1,  // worker -> coordinator, no payload
+    MESSAGE_JOB,        // coordinator -> worker, RenderJob
+    MESSAGE_RESULT,     // worker -> coordinator, JobResult + tileWidth * tileHeight RGBA floats
+    MESSAGE_DONE        // coordinator -> worker, no work left
+};
+
+struct MessageHeader {
+    uint32_t type;
+    uint32_t version;
+    uint64_t size;
+};
+
+struct RenderJob {
+    int32_t id;
+    int32_t width;          // whole frame
+    int32_t height;
+    int32_t tileX;
+    int32_t tileY;
+    int32_t tileWidth;
+    int32_t tileHeight;
+    int32_t firstFrame;     // sample range, in frames
+    int32_t frames;
+    float cameraPosition[3];
+    float yaw;
+    float pitch;
+    int32_t framesInFlight; // the coordinator's --frames-in-flight, 0 = offline default
+};
+
+struct JobResult {
+    int32_t id;
+    int32_t tileX;
+    int32_t tileY;
+    int32_t tileWidth;
+    int32_t tileHeight;
+};
+
+static bool sendMessage(Socket& socket, MessageType type, const void* data, size_t size,
+    const void* extra = nullptr, size_t extraSize = 0)
+{
+    MessageHeader header = { type, PROTOCOL_VERSION, size + extraSize };
+    return socket.sendAll(&header, sizeof(header))
+        && (size == 0 || socket.sendAll(data, size))
+        && (extraSize == 0 || socket.sendAll(extra, extraSize));
+}
+
+static bool receiveHeader(Socket& socket, MessageHeader& header)
+{
+    return socket.receiveAll(&header, sizeof(header)) && header.version == PROTOCOL_VERSION;
+}
+
+int runCoordinator(const HeadlessOptions& options, const std::string& address)
+{
+    Socket server = Socket::listen(address);
+    if (!server.valid()) {
+        return -1;
+    }
+
+    // Either tiles that each get every sample, or the whole frame in slices of jobFrames frames
+    bool splitSamples = options.jobFrames > 0;
+    int tileSize = splitSamples ? std::max(options.width, options.height) : options.tileSize > 0 ? options.tileSize : 256;
+    int jobFrames = splitSamples ? options.jobFrames : options.frames;
+    std::deque<RenderJob> queue;
+    for (int frame = 0; frame < options.frames; frame += jobFrames) {
+        for (int y = 0; y < options.height; y += tileSize) {
+            for (int x = 0; x < options.width; x += tileSize) {
+                RenderJob job = {};
+                job.id = (int32_t)queue.size();
+                job.width = options.width;
+                job.height = options.height;
+                job.tileX = x;
+                job.tileY = y;
+                job.tileWidth = std::min(tileSize, options.width - x);
+                job.tileHeight = std::min(tileSize, options.height - y);
+                job.firstFrame = options.firstFrame + frame;
+                job.frames = std::min(jobFrames, options.frames - frame);
+                job.cameraPosition[0] = options.cameraPosition.x;
+                job.cameraPosition[1] = options.cameraPosition.y;
+                job.cameraPosition[2] = options.cameraPosition.z;
+                job.yaw = options.yaw;
+                job.pitch = options.pitch;
+                job.framesInFlight = options.framesInFlight;
+                queue.push_back(job);
+            }
+        }
+    }
+    int total = (int)queue.size();
+    if (splitSamples) {
+        std::cout << "coordinator on " << address << ", " << total << " jobs of " << jobFrames * SAMPLES_PER_FRAME << " samples\n";
+    }
+    else {
+        std::cout << "coordinator on " << address << ", " << total << " tiles of " << tileSize << " pixels\n";
+    }
+
+    // Sums and sample counts of the whole frame, rows bottom to top
+    std::vector<float> accumulation(size_t(options.width) * options.height * 4, 0.0f);
+    std::mutex mutex;
+    std::condition_variable changed;
+    int completed = 0;
+    // Float sums depend on the order they are added in. Results are merged in job order, early
+    // arrivals wait here, so the output is the same however the jobs were scheduled.
+    std::map<int, std::pair<RenderJob, std::vector<float>>> pending;
+    int nextToMerge = 0;
+
+    // One thread per connected worker, each hands out jobs until the queue is drained
+    auto serve = [&](Socket socket, int worker) {
+        MessageHeader header;
+        if (!receiveHeader(socket, header) || header.type != MESSAGE_HELLO) {
+            std::cout << "\nworker " << worker << " did not introduce itself\n";
+            return;
+        }
+
+        std::vector<float> pixels;
+        for (;;) {
+            RenderJob job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                // a job can come back into the queue if another worker is lost
+                changed.wait(lock, [&] { return !queue.empty() || completed == total; });
+                if (queue.empty()) {
+                    break;
+                }
+                job = queue.front();
+                queue.pop_front();
+            }
+
+            size_t pixelBytes = size_t(job.tileWidth) * job.tileHeight * 4 * sizeof(float);
+            JobResult result;
+            bool ok = sendMessage(socket, MESSAGE_JOB, &job, sizeof(job))
+                && receiveHeader(socket, header) && header.type == MESSAGE_RESULT
+                && header.size == sizeof(JobResult) + pixelBytes
+                && socket.receiveAll(&result, sizeof(result)) && result.id == job.id;
+            if (ok) {
+                pixels.resize(pixelBytes / sizeof(float));
+                ok = socket.receiveAll(pixels.data(), pixelBytes);
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!ok) {
+                std::cout << "\nlost worker " << worker << ", job " << job.id << " goes back into the queue\n";
+                queue.push_front(job);
+                changed.notify_all();
+                return;
+            }
+
+            pending.emplace(job.id, std::make_pair(job, std::move(pixels)));
+            pixels = std::vector<float>();
+            for (auto next = pending.find(nextToMerge); next != pending.end(); next = pending.find(++nextToMerge)) {
+                // Adding sums and counts keeps the result weighted by samples, however the work was split
+                const RenderJob& tile = next->second.first;
+                for (int y = 0; y < tile.tileHeight; y++) {
+                    float* dst = &accumulation[(size_t(tile.tileY + y) * options.width + tile.tileX) * 4];
+                    const float* src = &next->second.second[size_t(y) * tile.tileWidth * 4];
+                    for (int i = 0; i < tile.tileWidth * 4; i++) {
+                        dst[i] += src[i];
+                    }
+                }
+                pending.erase(next);
+            }
+            completed++;
+            std::cout << "\rjob " << completed << "/" << total << " (worker " << worker << ")" << std::flush;
+            changed.notify_all();
+        }
+        sendMessage(socket, MESSAGE_DONE, nullptr, 0);
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> connections;
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (completed == total) {
+                break;
+            }
+        }
+        Socket socket = server.accept(100);
+        if (socket.valid()) {
+            connections.emplace_back(serve, std::move(socket), (int)connections.size() + 1);
+        }
+    }
+    for (std::thread& connection : connections) {
+        connection.join();
+    }
+    server.close();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "\nrendered " << total << " jobs on " << connections.size() << " workers in " << seconds << " s\n";
+
+    if (!writeAccumulation(options, accumulation)) {
+        return -1;
+    }
+    std::cout << "wrote " << options.output << "\n";
+    return 0;
+}
+
+int runWorker(const std::string& address)
+{
+    Socket socket;
+    for (int attempt = 0; attempt < 100 && !socket.valid(); attempt++) {
+        socket = Socket::connect(address);
+        if (!socket.valid()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+    if (!socket.valid() || !sendMessage(socket, MESSAGE_HELLO, nullptr, 0)) {
+        std::cout << "Failed to connect to " << address << "\n";
+        return -1;
+    }
+
+    // The context is only created once there is work
+    HeadlessContext context;
+    bool hasContext = false;
+    std::unique_ptr<Renderer> renderer;
+    std::vector<float> texels, pixels;
+    int jobs = 0;
+
+    bool ok = true;
+    for (;;) {
+        MessageHeader header;
+        RenderJob job;
+        if (!receiveHeader(socket, header)) {
+            std::cout << "Lost the coordinator\n";
+            ok = false;
+            break;
+        }
+        if (header.type == MESSAGE_DONE) {
+            break;
+        }
+        if (header.type != MESSAGE_JOB || header.size != sizeof(job) || !socket.receiveAll(&job, sizeof(job))) {
+            std::cout << "Unexpected message from the coordinator\n";
+            ok = false;
+            break;
+        }
+
+        if (!hasContext) {
+            if (!context.create()) {
+                return -1;
+            }
+            hasContext = true;
+        }
+
+        // edge tiles along the right and top are smaller and fit in the same renderer
+        if (!renderer || renderer->getWidth() < job.tileWidth || renderer->getHeight() < job.tileHeight) {
+            renderer.reset();
+            renderer = std::make_unique<Renderer>(job.tileWidth, job.tileHeight);
+            renderer->settings.denoiser.enabled = false;
+        }
+        renderer->setFrameOffset(job.firstFrame);
+        renderer->setTile(job.tileX, job.tileY, job.width, job.height);
+        Camera camera(glm::vec3(job.cameraPosition[0], job.cameraPosition[1], job.cameraPosition[2]),
+            glm::vec3(0.0f, 1.0f, 0.0f), job.yaw, job.pitch);
+        renderer->setCamera(camera);
+
+        FramePacer pacer(job.framesInFlight > 0 ? job.framesInFlight : 3);
+        for (int frame = 0; frame < job.frames; frame++) {
+            pacer.beginFrame();
+            renderer->render(false);
+            pacer.endFrame();
+        }
+
+        renderer->readAccumulation(texels);
+        int stride = renderer->getWidth();
+        pixels.resize(size_t(job.tileWidth) * job.tileHeight * 4);
+        for (int y = 0; y < job.tileHeight; y++) {
+            std::copy_n(&texels[size_t(y) * stride * 4], job.tileWidth * 4, &pixels[size_t(y) * job.tileWidth * 4]);
+        }
+
+        JobResult result = { job.id, job.tileX, job.tileY, job.tileWidth, job.tileHeight };
+        if (!sendMessage(socket, MESSAGE_RESULT, &result, sizeof(result), pixels.data(), pixels.size() * sizeof(float))) {
+            std::cout << "Lost the coordinator\n";
+            ok = false;
+            break;
+        }
+        jobs++;
+    }
+
+    renderer.reset();
+    context.destroy();
+    std::cout << "rendered " << jobs << " jobs\n";
+    return ok ? 0 : -1;
+}
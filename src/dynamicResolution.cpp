@@ -0,0 +1,120 @@
+#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+// scales are multiples of this, so small timing changes do not reallocate anything
+static const float SCALE_STEP = 1.0f / 16.0f;
+// measurements ignored after a change, the first frames at a new size pay for allocations
+// and first use, and the very first ones for compiling the shaders
+static const int WARMUP_FRAMES = 2;
+// measurements averaged after the warm-up before the next change
+static const int SETTLE_FRAMES = 8;
+
+DynamicResolution::DynamicResolution(double targetMilliseconds, int latency)
+    : target(targetMilliseconds), minScale(0.25f), maxScale(1.0f), scale(1.0f), gpuTime(0.0),
+    settledFrames(0), generation(0), frames(latency < 1 ? 1 : latency), head(0)
+{
+    for (FrameQueries& queries : frames) {
+        glGenQueries(1, &queries.begin);
+        glGenQueries(1, &queries.end);
+    }
+}
+
+DynamicResolution::~DynamicResolution()
+{
+    for (FrameQueries& queries : frames) {
+        glDeleteQueries(1, &queries.begin);
+        glDeleteQueries(1, &queries.end);
+    }
+}
+
+void DynamicResolution::setRange(float minScale, float maxScale)
+{
+    this->minScale = minScale;
+    this->maxScale = std::max(minScale, maxScale);
+    float clamped = std::min(std::max(scale, this->minScale), this->maxScale);
+    if (clamped != scale) {
+        scale = clamped;
+        generation++;
+        settledFrames = 0;
+    }
+}
+
+void DynamicResolution::beginFrame()
+{
+    // the oldest frame's queries are reused, whatever of them arrived is taken first
+    FrameQueries& queries = frames[head];
+    collect(queries);
+    glQueryCounter(queries.begin, GL_TIMESTAMP);
+}
+
+void DynamicResolution::endFrame()
+{
+    FrameQueries& queries = frames[head];
+    glQueryCounter(queries.end, GL_TIMESTAMP);
+    queries.pending = true;
+    queries.generation = generation;
+    head = (head + 1) % frames.size();
+
+    // the next frames' results, in order, as long as they are there
+    for (size_t i = 0; i < frames.size(); i++) {
+        FrameQueries& next = frames[(head + i) % frames.size()];
+        if (!next.pending) {
+            continue;
+        }
+        GLint available = 0;
+        glGetQueryObjectiv(next.end, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            break;
+        }
+        collect(next);
+    }
+}
+
+void DynamicResolution::collect(FrameQueries& queries)
+{
+    if (!queries.pending) {
+        return;
+    }
+    queries.pending = false;
+    GLint available = 0;
+    glGetQueryObjectiv(queries.end, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available || queries.generation != generation) {
+        return;
+    }
+    GLuint64 begin = 0, end = 0;
+    glGetQueryObjectui64v(queries.begin, GL_QUERY_RESULT, &begin);
+    glGetQueryObjectui64v(queries.end, GL_QUERY_RESULT, &end);
+    if (end > begin) {
+        update((end - begin) / 1e6);
+    }
+}
+
+void DynamicResolution::update(double milliseconds)
+{
+    settledFrames++;
+    if (settledFrames <= WARMUP_FRAMES) {
+        return;
+    }
+    gpuTime = settledFrames == WARMUP_FRAMES + 1 ? milliseconds : gpuTime * 0.8 + milliseconds * 0.2;
+    if (settledFrames < WARMUP_FRAMES + SETTLE_FRAMES) {
+        return;
+    }
+
+    // aim a little under the budget; going up needs a clear margin, going down does not wait
+    float ideal = scale * (float)std::sqrt(target * 0.9 / gpuTime);
+    float next = scale;
+    if (gpuTime > target) {
+        next = std::floor(ideal / SCALE_STEP) * SCALE_STEP;
+    }
+    else if (gpuTime < target * 0.75) {
+        next = std::floor(std::min(ideal, scale * 1.25f) / SCALE_STEP) * SCALE_STEP;
+    }
+    next = std::min(std::max(next, minScale), maxScale);
+    if (next != scale) {
+        scale = next;
+        generation++;
+        settledFrames = 0;
+    }
+}
@@ -0,0 +1,55 @@
+#include "FileWatcher.h"
+
+#include <iostream>
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+FileWatcher::FileWatcher(const std::string& directory)
+    : lastPoll(std::chrono::steady_clock::now())
+{
+#ifdef __linux__
+    fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd >= 0 && inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE) < 0) {
+        std::cout << "Cannot watch " << directory << ": " << std::strerror(errno) << std::endl;
+        close(fd);
+        fd = -1;
+    }
+#else
+    (void)directory;
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+#ifdef __linux__
+    if (fd >= 0) {
+        close(fd);
+    }
+#endif
+}
+
+bool FileWatcher::poll()
+{
+#ifdef __linux__
+    if (fd >= 0) {
+        // only whether anything happened matters, the events themselves are drained unread
+        alignas(inotify_event) char events[4096];
+        bool changed = false;
+        while (read(fd, events, sizeof(events)) > 0) {
+            changed = true;
+        }
+        return changed;
+    }
+#endif
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (now - lastPoll < std::chrono::milliseconds(500)) {
+        return false;
+    }
+    lastPoll = now;
+    return true;
+}
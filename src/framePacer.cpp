@@ -0,0 +1,77 @@
+#include "FramePacer.h"
+
+FramePacer::FramePacer(int maxFramesInFlight)
+    : maxFramesInFlight(maxFramesInFlight < 1 ? 1 : maxFramesInFlight), profiler(nullptr),
+    inputTime(std::chrono::steady_clock::now()), lastLatency(0.0), lastWait(0.0)
+{
+}
+
+FramePacer::~FramePacer()
+{
+    for (Frame& frame : inFlight) {
+        glDeleteSync(frame.fence);
+        glDeleteQueries(1, &frame.timestamp);
+    }
+}
+
+bool FramePacer::retire(bool wait)
+{
+    Frame& frame = inFlight.front();
+    for (;;) {
+        GLenum result = glClientWaitSync(frame.fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? 1000000000ull : 0);
+        if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED) break;
+        if (!wait) return false;
+    }
+
+    // the GPU clock against the CPU clock right now puts the GPU timestamp on the CPU timeline
+    GLint64 gpuNow = 0;
+    GLuint64 gpuDone = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    std::chrono::steady_clock::time_point cpuNow = std::chrono::steady_clock::now();
+    glGetQueryObjectui64v(frame.timestamp, GL_QUERY_RESULT, &gpuDone);
+    if (gpuDone > 0 && (GLint64)gpuDone <= gpuNow) {
+        std::chrono::steady_clock::time_point done = cpuNow - std::chrono::nanoseconds(gpuNow - (GLint64)gpuDone);
+        lastLatency = std::chrono::duration<double, std::milli>(done - frame.input).count();
+        if (profiler) {
+            profiler->addCpu("input latency", lastLatency);
+        }
+    }
+
+    glDeleteSync(frame.fence);
+    glDeleteQueries(1, &frame.timestamp);
+    inFlight.pop_front();
+    return true;
+}
+
+void FramePacer::beginFrame()
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    while (!inFlight.empty() && retire(false)) {}
+    while ((int)inFlight.size() >= maxFramesInFlight) {
+        retire(true);
+    }
+    inputTime = std::chrono::steady_clock::now();
+    lastWait = std::chrono::duration<double, std::milli>(inputTime - start).count();
+    if (profiler) {
+        profiler->addCpu("pacing wait", lastWait);
+    }
+}
+
+void FramePacer::endFrame()
+{
+    Frame frame;
+    frame.input = inputTime;
+    glGenQueries(1, &frame.timestamp);
+    glQueryCounter(frame.timestamp, GL_TIMESTAMP);
+    frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    // without a flush the commands may sit in the driver and the fence never gets executed
+    glFlush();
+    inFlight.push_back(frame);
+}
+
+void FramePacer::finish()
+{
+    while (!inFlight.empty()) {
+        retire(true);
+    }
+}
@@ -0,0 +1,663 @@
+#include "Headless.h"
+
+#include <glad/glad.h>
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "HeadlessContext.h"
+#include "Renderer.h"
+#include "CpuDenoiser.h"
+#include "ImageIO.h"
+#include "ReadbackRing.h"
+#include "ImageWriter.h"
+#include "TiledImageFile.h"
+#include "Checkpoint.h"
+#include "FramePacer.h"
+
+static void printUsage(const char* program)
+{
+    std::cout << "usage: " << program << " [--headless] [--frames N] [--width W] [--height H]\n"
+        "       [--output file.png|.ppm|.exr|.pfm] [--exr-compression none|zip]\n"
+        "       [--capture-interval N] [--turntable VIEWS] [--turntable-center X Y Z] [--tile SIZE]\n"
+        "       [--checkpoint FILE] [--checkpoint-interval N] [--resume]\n"
+        "       [--sample-range FIRST COUNT] [--partial FILE]\n"
+        "       [--denoise none|gpu|cpu] [--exposure E] [--camera X Y Z] [--yaw DEG] [--pitch DEG]\n"
+        "       [--profile] [--ray-stats] [--frames-in-flight N] [--target-fps N]\n"
+        "       " << program << " --merge PARTIAL [--merge PARTIAL ...] --output FILE [--exposure E]\n"
+        "       " << program << " --coordinator ADDRESS [--job-samples N] [render options]\n"
+        "       " << program << " --worker ADDRESS\n"
+        "ADDRESS is host:port, port or unix:/path\n";
+}
+
+static bool endsWith(const std::string& text, const char* suffix)
+{
+    size_t length = std::strlen(suffix);
+    return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+}
+
+bool parseCommandLine(int argc, char** argv, HeadlessOptions& options)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        // --headless, --resume, --profile and --ray-stats are switches, everything else takes a value
+        auto value = [&]() -> const char* { return i + 1 < argc ? argv[++i] : nullptr; };
+
+        if (arg == "--headless") {
+            options.enabled = true;
+            continue;
+        }
+        if (arg == "--resume") {
+            options.resume = true;
+            continue;
+        }
+        if (arg == "--profile") {
+            options.profile = true;
+            continue;
+        }
+        if (arg == "--ray-stats") {
+            options.rayStats = true;
+            continue;
+        }
+
+        const char* v = value();
+        if (!v) {
+            std::cout << "missing value for " << arg << "\n";
+            printUsage(argv[0]);
+            return false;
+        }
+
+        if (arg == "--frames") options.frames = std::atoi(v);
+        else if (arg == "--width") options.width = std::atoi(v);
+        else if (arg == "--height") options.height = std::atoi(v);
+        else if (arg == "--output") options.output = v;
+        else if (arg == "--capture-interval") options.captureInterval = std::atoi(v);
+        else if (arg == "--exposure") options.exposure = (float)std::atof(v);
+        else if (arg == "--yaw") options.yaw = (float)std::atof(v);
+        else if (arg == "--pitch") options.pitch = (float)std::atof(v);
+        else if (arg == "--turntable") options.turntable = std::atoi(v);
+        else if (arg == "--frames-in-flight") options.framesInFlight = std::atoi(v);
+        else if (arg == "--target-fps") options.targetFps = std::atoi(v);
+        else if (arg == "--tile") options.tileSize = std::atoi(v);
+        else if (arg == "--coordinator") options.coordinatorAddress = v;
+        else if (arg == "--worker") options.workerAddress = v;
+        else if (arg == "--partial") options.partialPath = v;
+        else if (arg == "--job-samples") options.jobFrames = std::max(1, std::atoi(v) / SAMPLES_PER_FRAME);
+        else if (arg == "--merge") options.mergeInputs.push_back(v);
+        else if (arg == "--sample-range") {
+            const char* count = value();
+            if (!count) {
+                std::cout << "--sample-range takes the first sample and the sample count\n";
+                return false;
+            }
+            int first = std::atoi(v);
+            int samples = std::atoi(count);
+            if (first < 0 || first % SAMPLES_PER_FRAME != 0 || samples % SAMPLES_PER_FRAME != 0) {
+                std::cout << "sample ranges have to start and end on multiples of " << SAMPLES_PER_FRAME << "\n";
+                return false;
+            }
+            options.firstFrame = first / SAMPLES_PER_FRAME;
+            options.frames = samples / SAMPLES_PER_FRAME;
+        }
+        else if (arg == "--checkpoint") options.checkpointPath = v;
+        else if (arg == "--checkpoint-interval") options.checkpointInterval = std::atoi(v);
+        else if (arg == "--camera" || arg == "--turntable-center") {
+            const char* y = value();
+            const char* z = value();
+            if (!y || !z) {
+                std::cout << arg << " takes three values\n";
+                return false;
+            }
+            glm::vec3 point(std::atof(v), std::atof(y), std::atof(z));
+            (arg == "--camera" ? options.cameraPosition : options.turntableCenter) = point;
+        }
+        else if (arg == "--exr-compression") {
+            std::string mode = v;
+            if (mode == "none") options.exrCompression = EXR_NO_COMPRESSION;
+            else if (mode == "zip") options.exrCompression = EXR_ZIP_COMPRESSION;
+            else {
+                std::cout << "unknown EXR compression: " << mode << "\n";
+                return false;
+            }
+        }
+        else if (arg == "--denoise") {
+            std::string mode = v;
+            if (mode == "none") options.denoise = DENOISE_NONE;
+            else if (mode == "gpu") options.denoise = DENOISE_GPU;
+            else if (mode == "cpu") options.denoise = DENOISE_CPU;
+            else {
+                std::cout << "unknown denoiser: " << mode << "\n";
+                return false;
+            }
+        }
+        else {
+            std::cout << "unknown option: " << arg << "\n";
+            printUsage(argv[0]);
+            return false;
+        }
+    }
+
+    if (options.frames < 1 || options.width < 1 || options.height < 1) {
+        std::cout << "frames, width and height must be positive\n";
+        return false;
+    }
+    return true;
+}
+
+// render.ppm, 12 -> render_00012.ppm
+static std::string framePath(const std::string& output, uint64_t frame)
+{
+    size_t dot = output.find_last_of('.');
+    size_t slash = output.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        dot = output.size();
+    }
+    char number[32];
+    std::snprintf(number, sizeof(number), "_%05llu", (unsigned long long)frame);
+    return output.substr(0, dot) + number + output.substr(dot);
+}
+
+// The CPU denoiser's output goes through the regular resolve pass, so 8-bit images are
+// tonemapped the same way the window would show them
+static GLuint uploadImage(int width, int height, const std::vector<float>& rgb)
+{
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, width, height, 0, GL_RGB, GL_FLOAT, rgb.data());
+    return texture;
+}
+
+// Whole frames, one image per view
+static bool renderViews(const HeadlessOptions& options)
+{
+    Renderer renderer(options.width, options.height);
+    renderer.settings.exposure = options.exposure;
+    renderer.settings.denoiser.enabled = options.denoise == DENOISE_GPU;
+    renderer.setFrameOffset(options.firstFrame);
+    std::unique_ptr<Profiler> profiler;
+    if (options.profile) {
+        profiler = std::make_unique<Profiler>();
+        renderer.setProfiler(profiler.get());
+    }
+    // enough frames queued to keep the GPU busy, without the driver queueing the whole render
+    FramePacer pacer(options.framesInFlight > 0 ? options.framesInFlight : 3);
+    pacer.setProfiler(profiler.get());
+    renderer.settings.collectRayStats = options.rayStats;
+    FrameRayStats latestRayStats;
+    uint64_t totalRays = 0, totalBounces = 0, totalTerminations = 0, totalTests = 0, totalPaths = 0;
+    double totalRaySeconds = 0.0;
+    auto drainRayStats = [&]() {
+        FrameRayStats stats;
+        while (renderer.readRayStats(stats)) {
+            totalRays += stats.counters.rays;
+            totalBounces += stats.counters.bounces;
+            totalTerminations += stats.counters.terminations;
+            totalTests += stats.counters.primitiveTests;
+            totalPaths += stats.counters.paths;
+            totalRaySeconds += stats.gpuSeconds;
+            latestRayStats = stats;
+        }
+    };
+
+    // Frames are read back through a PBO ring and encoded on the writer's threads, so
+    // tracing the next frame (or view) overlaps both the copy and the encoding
+    bool floatOutput = endsWith(options.output, ".pfm") || endsWith(options.output, ".exr");
+    size_t pixelCount = size_t(options.width) * options.height;
+    ReadbackRing readback(options.width, options.height, GL_RGBA,
+        floatOutput ? GL_FLOAT : GL_UNSIGNED_BYTE, floatOutput ? 16 : 4);
+    std::deque<std::string> readbackPaths;  // same order as the ring
+
+    ImageWriterSettings writerSettings;
+    writerSettings.exrCompression = options.exrCompression;
+    ImageWriter writer(writerSettings);
+
+    // Hands the oldest finished readback over to the writer. True once a readback was
+    // retired, even a failed one, whose image is then reported and left out.
+    int readbackFailures = 0;
+    auto retire = [&](bool wait) {
+        std::vector<unsigned char> pixels;
+        uint64_t frame;
+        ReadbackResult result = readback.read(pixels, frame, wait);
+        if (result == READBACK_NOT_READY) {
+            return false;
+        }
+        ImageJob job;
+        job.path = readbackPaths.front();
+        job.width = options.width;
+        job.height = options.height;
+        readbackPaths.pop_front();
+        if (result == READBACK_FAILED) {
+            std::cout << "Failed to read back the image for " << job.path << std::endl;
+            readbackFailures++;
+            return true;
+        }
+        if (floatOutput) {
+            Renderer::averageSamples((const float*)pixels.data(), pixelCount, job.rgb);
+        }
+        else {
+            job.rgba8 = std::move(pixels);
+        }
+        writer.submit(std::move(job));
+        return true;
+    };
+
+    auto capture = [&](const std::string& path) {
+        if (readback.full() && !retire(true)) {
+            std::cout << "Readback ring is stuck, no image for " << path << std::endl;
+            readbackFailures++;
+            return;
+        }
+        bool requested;
+        if (floatOutput) {
+            requested = readback.request(renderer.getDisplayTexture(), renderer.getFrameCount());
+        }
+        else {
+            renderer.resolve();
+            requested = readback.request(renderer.getResolvedTexture(), renderer.getFrameCount());
+        }
+        if (requested) {
+            readbackPaths.push_back(path);
+        }
+    };
+
+    // A turntable orbits the camera around the vertical axis through turntableCenter
+    int views = std::max(1, options.turntable);
+    glm::vec3 orbit = options.cameraPosition - options.turntableCenter;
+
+    // Checkpoints take the same route: an asynchronous readback, then a save on another thread
+    bool checkpointing = !options.checkpointPath.empty() && options.checkpointInterval > 0;
+    std::unique_ptr<ReadbackRing> accumulationReadback;
+    std::unique_ptr<ReadbackRing> momentsReadback;
+    if (checkpointing) {
+        accumulationReadback = std::make_unique<ReadbackRing>(options.width, options.height, GL_RGBA, GL_FLOAT, 16, 1);
+        if (renderer.settings.denoiser.enabled) {
+            momentsReadback = std::make_unique<ReadbackRing>(options.width, options.height, GL_RG, GL_FLOAT, 8, 1);
+        }
+    }
+    CheckpointWriter checkpointWriter;
+    int checkpointView = 0;
+
+    auto retireCheckpoint = [&](bool wait) {
+        Checkpoint checkpoint;
+        checkpoint.accumulation.resize(pixelCount * 4);
+        uint64_t frameCount;
+        if (!accumulationReadback->read(checkpoint.accumulation.data(), frameCount, wait)) {
+            return false;
+        }
+        if (momentsReadback) {
+            checkpoint.moments.resize(pixelCount * 2);
+            momentsReadback->read(checkpoint.moments.data(), frameCount, true);
+        }
+        checkpoint.width = options.width;
+        checkpoint.height = options.height;
+        checkpoint.view = checkpointView;
+        checkpoint.firstFrame = options.firstFrame;
+        checkpoint.frameCount = (uint32_t)frameCount;
+        checkpointWriter.save(options.checkpointPath, std::move(checkpoint));
+        return true;
+    };
+
+    int firstView = 0;
+    Checkpoint resumed;
+    bool resuming = false;
+    if (options.resume && !options.checkpointPath.empty()) {
+        resuming = loadCheckpoint(options.checkpointPath, resumed);
+        if (resuming && (resumed.width != options.width || resumed.height != options.height || resumed.view >= views
+            || resumed.firstFrame != (uint32_t)options.firstFrame)) {
+            std::cout << "checkpoint is " << resumed.width << "x" << resumed.height << " view " << resumed.view
+                << ", which does not match this render\n";
+            resuming = false;
+        }
+        if (resuming) {
+            firstView = resumed.view;
+            std::cout << "resuming view " << firstView + 1 << " at frame " << resumed.frameCount << "\n";
+        }
+        else {
+            std::cout << "starting from scratch\n";
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int view = firstView; view < views; view++) {
+        std::string viewPath = options.turntable > 0 ? framePath(options.output, view) : options.output;
+
+        float angle = glm::two_pi<float>() * view / views;
+        glm::vec3 position = options.turntableCenter + glm::vec3(
+            orbit.x * std::cos(angle) + orbit.z * std::sin(angle),
+            orbit.y,
+            orbit.z * std::cos(angle) - orbit.x * std::sin(angle));
+        Camera camera(position, glm::vec3(0.0f, 1.0f, 0.0f), options.yaw - glm::degrees(angle), options.pitch);
+        renderer.resetAccumulation();
+        renderer.setCamera(camera);
+
+        int firstFrame = 0;
+        if (resuming) {
+            renderer.restoreAccumulation(resumed.frameCount, resumed.accumulation, resumed.moments);
+            firstFrame = std::min((int)resumed.frameCount, options.frames);
+            resumed = Checkpoint();
+            resuming = false;
+        }
+        for (int frame = firstFrame; frame < options.frames; frame++) {
+            if (profiler) {
+                profiler->beginFrame();
+            }
+            ScopedCpuTimer frameTimer(profiler.get(), "frame");
+            pacer.beginFrame();
+            renderer.render(false);
+            while (retire(false)) {}
+            drainRayStats();
+
+            if (checkpointing) {
+                if (!checkpointWriter.busy()) {
+                    retireCheckpoint(false);
+                }
+                if (renderer.getFrameCount() % options.checkpointInterval == 0 && frame + 1 < options.frames) {
+                    if (accumulationReadback->full()) {
+                        retireCheckpoint(true);
+                    }
+                    accumulationReadback->request(renderer.getAccumulationTexture(), renderer.getFrameCount());
+                    if (momentsReadback) {
+                        momentsReadback->request(renderer.getMomentsTexture(), renderer.getFrameCount());
+                    }
+                    checkpointView = view;
+                }
+            }
+
+            if (options.captureInterval > 0 && (frame + 1) % options.captureInterval == 0) {
+                capture(framePath(viewPath, frame + 1));
+            }
+
+            pacer.endFrame();
+
+            if ((frame + 1) % 16 == 0 || frame + 1 == options.frames) {
+                std::cout << "\rview " << view + 1 << "/" << views
+                    << " frame " << frame + 1 << "/" << options.frames;
+                if (latestRayStats.frame > 0) {
+                    std::cout << ", frame " << latestRayStats.frame << ": " << latestRayStats.mraysPerSecond()
+                        << " Mrays/s, path depth " << latestRayStats.averagePathDepth();
+                }
+                std::cout << std::flush;
+            }
+            if (profiler) {
+                profiler->endFrame();
+            }
+        }
+
+        if (!options.partialPath.empty() && view == 0) {
+            Checkpoint partial;
+            partial.width = options.width;
+            partial.height = options.height;
+            partial.firstFrame = options.firstFrame;
+            partial.frameCount = renderer.getFrameCount();
+            renderer.readAccumulation(partial.accumulation);
+            saveCheckpoint(options.partialPath, partial);
+        }
+
+        if (options.denoise != DENOISE_CPU) {
+            capture(viewPath);
+            continue;
+        }
+
+        // The CPU denoiser needs the feature buffers right away, this path reads back synchronously
+        CpuAovs aovs;
+        renderer.readAovs(aovs);
+        CpuDenoiser cpuDenoiser;
+        ImageJob job;
+        job.path = viewPath;
+        job.width = options.width;
+        job.height = options.height;
+        cpuDenoiser.denoise(aovs, job.rgb);
+        if (!floatOutput) {
+            GLuint denoised = uploadImage(options.width, options.height, job.rgb);
+            renderer.resolve(denoised);
+            renderer.readResolved(job.rgba8);
+            glDeleteTextures(1, &denoised);
+        }
+        writer.submit(std::move(job));
+    }
+
+    while (retire(true)) {}
+    writer.flush();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "\nrendered " << views * options.frames << " frames in " << seconds << " s\n";
+    if (profiler) {
+        profiler->print(std::cout);
+    }
+    drainRayStats();
+    if (totalPaths > 0) {
+        // wall clock throughput includes everything else the frame loop did
+        std::cout << totalRays << " rays, " << totalRays / seconds * 1e-6 << " Mrays/s overall";
+        if (totalRaySeconds > 0.0) {
+            std::cout << ", " << totalRays / totalRaySeconds * 1e-6 << " Mrays/s in the trace pass";
+        }
+        std::cout << "\naverage path depth " << double(totalBounces) / totalPaths
+            << ", " << 100.0 * totalTerminations / totalPaths << "% of paths terminated early, "
+            << double(totalTests) / totalRays << " primitive tests per ray\n";
+    }
+
+    bool ok = writer.getFailures() == 0 && readbackFailures == 0;
+    if (ok) {
+        std::cout << "wrote " << (options.turntable > 0 ? framePath(options.output, 0) + " ..." : options.output) << "\n";
+    }
+
+    // a finished render has nothing left to resume
+    checkpointWriter.wait();
+    if (ok && checkpointing) {
+        std::remove(options.checkpointPath.c_str());
+    }
+    return ok;
+}
+
+// Print resolution frames: the renderer only holds one tile, which is accumulated to completion,
+// read back and written into the output file while the next tile renders. GPU and host memory
+// stay constant in the output resolution.
+static bool renderTiles(const HeadlessOptions& options)
+{
+    TiledImageFile file;
+    if (!file.open(options.output, options.width, options.height)) {
+        return false;
+    }
+    bool floatOutput = file.isFloat();
+    if (options.denoise != DENOISE_NONE || options.turntable > 0 || options.captureInterval > 0 || !options.checkpointPath.empty()) {
+        std::cout << "tiled rendering ignores --denoise, --turntable, --capture-interval and --checkpoint\n";
+    }
+
+    int tileSize = options.tileSize;
+    Renderer renderer(tileSize, tileSize);
+    renderer.settings.exposure = options.exposure;
+    renderer.setFrameOffset(options.firstFrame);
+    // the filters would leave seams along the tile borders
+    renderer.settings.denoiser.enabled = false;
+    Camera camera(options.cameraPosition, glm::vec3(0.0f, 1.0f, 0.0f), options.yaw, options.pitch);
+    FramePacer pacer(options.framesInFlight > 0 ? options.framesInFlight : 3);
+
+    ReadbackRing readback(tileSize, tileSize, GL_RGBA,
+        floatOutput ? GL_FLOAT : GL_UNSIGNED_BYTE, floatOutput ? 16 : 4);
+    std::deque<glm::ivec2> readbackTiles;   // same order as the ring
+    std::vector<unsigned char> pixels;
+    std::vector<float> rgb;
+    bool ok = true;
+
+    auto retire = [&](bool wait) {
+        uint64_t frame;
+        ReadbackResult result = readback.read(pixels, frame, wait);
+        if (result == READBACK_NOT_READY) {
+            return false;
+        }
+        glm::ivec2 tile = readbackTiles.front();
+        readbackTiles.pop_front();
+        if (result == READBACK_FAILED) {
+            std::cout << "\nFailed to read back the tile at " << tile.x << ", " << tile.y << std::endl;
+            ok = false;
+            return true;
+        }
+        int tileWidth = std::min(tileSize, options.width - tile.x);
+        int tileHeight = std::min(tileSize, options.height - tile.y);
+        if (floatOutput) {
+            Renderer::averageSamples((const float*)pixels.data(), size_t(tileSize) * tileSize, rgb);
+            ok = file.writeTile(tile.x, tile.y, tileWidth, tileHeight, tileSize, rgb.data()) && ok;
+        }
+        else {
+            ok = file.writeTile(tile.x, tile.y, tileWidth, tileHeight, tileSize, pixels.data()) && ok;
+        }
+        return true;
+    };
+
+    int tilesX = (options.width + tileSize - 1) / tileSize;
+    int tilesY = (options.height + tileSize - 1) / tileSize;
+    auto start = std::chrono::steady_clock::now();
+    for (int ty = 0; ty < tilesY; ty++) {
+        for (int tx = 0; tx < tilesX; tx++) {
+            glm::ivec2 tile(tx * tileSize, ty * tileSize);
+            renderer.setTile(tile.x, tile.y, options.width, options.height);
+            renderer.setCamera(camera);
+
+            for (int frame = 0; frame < options.frames; frame++) {
+                pacer.beginFrame();
+                renderer.render(false);
+                pacer.endFrame();
+                while (retire(false)) {}
+            }
+            std::cout << "\rtile " << ty * tilesX + tx + 1 << "/" << tilesX * tilesY << std::flush;
+
+            if (readback.full() && !retire(true)) {
+                std::cout << "\nReadback ring is stuck, no tile at " << tile.x << ", " << tile.y << std::endl;
+                ok = false;
+                continue;
+            }
+            bool requested;
+            if (floatOutput) {
+                requested = readback.request(renderer.getDisplayTexture(), renderer.getFrameCount());
+            }
+            else {
+                renderer.resolve();
+                requested = readback.request(renderer.getResolvedTexture(), renderer.getFrameCount());
+            }
+            if (requested) {
+                readbackTiles.push_back(tile);
+            }
+        }
+    }
+
+    while (retire(true)) {}
+    ok = file.close() && ok;
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "\nrendered " << tilesX * tilesY << " tiles of " << options.frames << " frames in " << seconds << " s\n";
+    if (ok) {
+        std::cout << "wrote " << options.output << "\n";
+    }
+    return ok;
+}
+
+bool writeAccumulation(const HeadlessOptions& options, const std::vector<float>& rgba)
+{
+    ImageJob job;
+    job.path = options.output;
+    job.width = options.width;
+    job.height = options.height;
+    Renderer::averageSamples(rgba.data(), size_t(options.width) * options.height, job.rgb);
+
+    bool floatOutput = endsWith(options.output, ".pfm") || endsWith(options.output, ".exr");
+    if (!floatOutput) {
+        HeadlessContext context;
+        if (!context.create()) {
+            return false;
+        }
+        {
+            Renderer renderer(options.width, options.height);
+            renderer.settings.exposure = options.exposure;
+            GLuint texture = uploadImage(options.width, options.height, job.rgb);
+            renderer.resolve(texture);
+            renderer.readResolved(job.rgba8);
+            glDeleteTextures(1, &texture);
+        }
+        context.destroy();
+    }
+
+    ImageWriterSettings writerSettings;
+    writerSettings.threads = 1;
+    writerSettings.exrCompression = options.exrCompression;
+    ImageWriter writer(writerSettings);
+    writer.submit(std::move(job));
+    writer.flush();
+    return writer.getFailures() == 0;
+}
+
+int runMerge(const HeadlessOptions& options)
+{
+    // Summing in sample order makes the result independent of the order the parts are given in
+    std::vector<Checkpoint> parts(options.mergeInputs.size());
+    std::vector<size_t> order(parts.size());
+    for (size_t i = 0; i < parts.size(); i++) {
+        if (!loadCheckpoint(options.mergeInputs[i], parts[i], true)) {
+            return -1;
+        }
+        if (parts[i].width != parts[0].width || parts[i].height != parts[0].height) {
+            std::cout << options.mergeInputs[i] << " has a different resolution\n";
+            return -1;
+        }
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return parts[a].firstFrame < parts[b].firstFrame; });
+
+    for (size_t i = 1; i < order.size(); i++) {
+        const Checkpoint& previous = parts[order[i - 1]];
+        if (previous.firstFrame + previous.frameCount > parts[order[i]].firstFrame) {
+            std::cout << options.mergeInputs[order[i - 1]] << " and " << options.mergeInputs[order[i]]
+                << " overlap, their samples would be counted twice\n";
+            return -1;
+        }
+    }
+
+    HeadlessOptions merged = options;
+    merged.width = parts[0].width;
+    merged.height = parts[0].height;
+    std::vector<float> accumulation(size_t(merged.width) * merged.height * 4, 0.0f);
+    uint32_t frames = 0;
+    for (size_t i : order) {
+        Checkpoint part;
+        if (!loadCheckpoint(options.mergeInputs[i], part)) {
+            return -1;
+        }
+        // the count channel adds up too, so every pixel ends up weighted by its samples
+        for (size_t k = 0; k < accumulation.size(); k++) {
+            accumulation[k] += part.accumulation[k];
+        }
+        frames += part.frameCount;
+        std::cout << "merged " << options.mergeInputs[i] << ": samples " << part.firstFrame * SAMPLES_PER_FRAME
+            << " to " << (part.firstFrame + part.frameCount) * SAMPLES_PER_FRAME << "\n";
+    }
+
+    if (!writeAccumulation(merged, accumulation)) {
+        return -1;
+    }
+    std::cout << "wrote " << options.output << " with " << frames * SAMPLES_PER_FRAME << " samples per pixel\n";
+    return 0;
+}
+
+int runHeadless(const HeadlessOptions& options)
+{
+    HeadlessContext context;
+    if (!context.create()) {
+        return -1;
+    }
+
+    // GL objects have to be gone before the context
+    bool ok = options.tileSize > 0 ? renderTiles(options) : renderViews(options);
+
+    context.destroy();
+    return ok ? 0 : -1;
+}
@@ -0,0 +1,208 @@
+#include "ImageIO.h"
+
+#include <glm/gtc/packing.hpp>
+#include <stb_image_write/stb_image_write.h>
+#include <stb_image_write/stb_zlib_compress.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+bool writePFM(const std::string& path, int width, int height, const std::vector<float>& rgb)
+{
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cout << "Failed to open " << path << " for writing\n";
+        return false;
+    }
+
+    // negative scale = little endian
+    std::fprintf(file, "PF\n%d %d\n-1.0\n", width, height);
+    size_t count = size_t(width) * height * 3;
+    bool ok = std::fwrite(rgb.data(), sizeof(float), count, file) == count;
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok) {
+        std::cout << "Failed to write " << path << "\n";
+    }
+    return ok;
+}
+
+bool writePPM(const std::string& path, int width, int height, const std::vector<unsigned char>& rgba)
+{
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cout << "Failed to open " << path << " for writing\n";
+        return false;
+    }
+
+    std::fprintf(file, "P6\n%d %d\n255\n", width, height);
+    std::vector<unsigned char> row(size_t(width) * 3);
+    bool ok = true;
+    for (int y = height - 1; y >= 0 && ok; y--) {
+        const unsigned char* src = &rgba[size_t(y) * width * 4];
+        for (int x = 0; x < width; x++) {
+            row[x * 3 + 0] = src[x * 4 + 0];
+            row[x * 3 + 1] = src[x * 4 + 1];
+            row[x * 3 + 2] = src[x * 4 + 2];
+        }
+        ok = std::fwrite(row.data(), 1, row.size(), file) == row.size();
+    }
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok) {
+        std::cout << "Failed to write " << path << "\n";
+    }
+    return ok;
+}
+
+bool writePNG(const std::string& path, int width, int height, const std::vector<unsigned char>& rgba)
+{
+    // a negative stride starting at the last row flips the image to top to bottom
+    int stride = width * 4;
+    const unsigned char* lastRow = rgba.data() + size_t(height - 1) * stride;
+    if (!stbi_write_png(path.c_str(), width, height, 4, lastRow, -stride)) {
+        std::cout << "Failed to write " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+// Byte order shuffle and delta predictor OpenEXR applies before deflating a ZIP block
+static void exrZipPrepare(const std::vector<unsigned char>& raw, std::vector<unsigned char>& prepared)
+{
+    size_t size = raw.size();
+    prepared.resize(size);
+    size_t half = (size + 1) / 2;
+    for (size_t i = 0; i < size; i++) {
+        prepared[(i & 1) ? half + i / 2 : i / 2] = raw[i];
+    }
+
+    int previous = prepared[0];
+    for (size_t i = 1; i < size; i++) {
+        int delta = int(prepared[i]) - previous + (128 + 256);
+        previous = prepared[i];
+        prepared[i] = (unsigned char)delta;
+    }
+}
+
+template <typename T>
+static void putValue(std::vector<unsigned char>& out, T value)
+{
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+static void putAttribute(std::vector<unsigned char>& out, const char* name, const char* type, const std::vector<unsigned char>& value)
+{
+    out.insert(out.end(), name, name + std::strlen(name) + 1);
+    out.insert(out.end(), type, type + std::strlen(type) + 1);
+    putValue<int32_t>(out, (int32_t)value.size());
+    out.insert(out.end(), value.begin(), value.end());
+}
+
+std::vector<unsigned char> exrHeader(int width, int height, ExrCompression compression)
+{
+    // EXR is little endian, values are copied as they are in memory
+    std::vector<unsigned char> header;
+    putValue<uint32_t>(header, 20000630);   // magic
+    putValue<uint32_t>(header, 2);          // version 2, single part scanline
+
+    std::vector<unsigned char> value;
+    for (const char* channel : { "B", "G", "R" }) {    // channels are sorted by name
+        value.push_back((unsigned char)channel[0]);
+        value.push_back(0);
+        putValue<int32_t>(value, 1);    // HALF
+        putValue<uint32_t>(value, 0);   // pLinear + reserved
+        putValue<int32_t>(value, 1);    // x sampling
+        putValue<int32_t>(value, 1);    // y sampling
+    }
+    value.push_back(0);
+    putAttribute(header, "channels", "chlist", value);
+
+    putAttribute(header, "compression", "compression", { (unsigned char)compression });
+
+    value.clear();
+    for (int32_t v : { 0, 0, width - 1, height - 1 }) putValue(value, v);
+    putAttribute(header, "dataWindow", "box2i", value);
+    putAttribute(header, "displayWindow", "box2i", value);
+
+    putAttribute(header, "lineOrder", "lineOrder", { 0 });  // increasing y
+    value.clear();
+    putValue(value, 1.0f);
+    putAttribute(header, "pixelAspectRatio", "float", value);
+    putAttribute(header, "screenWindowWidth", "float", value);
+    value.clear();
+    putValue(value, 0.0f);
+    putValue(value, 0.0f);
+    putAttribute(header, "screenWindowCenter", "v2f", value);
+    header.push_back(0);
+    return header;
+}
+
+bool writeEXR(const std::string& path, int width, int height, const std::vector<float>& rgb, ExrCompression compression)
+{
+    std::vector<unsigned char> header = exrHeader(width, height, compression);
+
+    int linesPerBlock = compression == EXR_ZIP_COMPRESSION ? 16 : 1;
+    int blockCount = (height + linesPerBlock - 1) / linesPerBlock;
+
+    // Blocks are written top to bottom (EXR y grows downwards), each line holds B, G then R
+    std::vector<std::vector<unsigned char>> blocks(blockCount);
+    std::vector<unsigned char> raw, prepared;
+    for (int block = 0; block < blockCount; block++) {
+        int firstLine = block * linesPerBlock;
+        int lineCount = std::min(linesPerBlock, height - firstLine);
+
+        raw.clear();
+        for (int line = firstLine; line < firstLine + lineCount; line++) {
+            const float* row = &rgb[size_t(height - 1 - line) * width * 3];
+            for (int channel = 2; channel >= 0; channel--) {
+                for (int x = 0; x < width; x++) {
+                    putValue<uint16_t>(raw, (uint16_t)glm::packHalf1x16(row[x * 3 + channel]));
+                }
+            }
+        }
+
+        std::vector<unsigned char>& chunk = blocks[block];
+        putValue<int32_t>(chunk, firstLine);
+        if (compression == EXR_ZIP_COMPRESSION) {
+            exrZipPrepare(raw, prepared);
+            int compressedSize = 0;
+            unsigned char* compressed = stbi_zlib_compress(prepared.data(), (int)prepared.size(), &compressedSize, 8);
+            // readers treat a block as stored when it is not smaller than the raw data
+            if (compressed && compressedSize < (int)raw.size()) {
+                putValue<int32_t>(chunk, compressedSize);
+                chunk.insert(chunk.end(), compressed, compressed + compressedSize);
+                std::free(compressed);
+                continue;
+            }
+            std::free(compressed);
+        }
+        putValue<int32_t>(chunk, (int32_t)raw.size());
+        chunk.insert(chunk.end(), raw.begin(), raw.end());
+    }
+
+    // Offset table, then the blocks
+    uint64_t offset = header.size() + sizeof(uint64_t) * blockCount;
+    for (const std::vector<unsigned char>& chunk : blocks) {
+        putValue<uint64_t>(header, offset);
+        offset += chunk.size();
+    }
+
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cout << "Failed to open " << path << " for writing\n";
+        return false;
+    }
+    bool ok = std::fwrite(header.data(), 1, header.size(), file) == header.size();
+    for (const std::vector<unsigned char>& chunk : blocks) {
+        ok = ok && std::fwrite(chunk.data(), 1, chunk.size(), file) == chunk.size();
+    }
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok) {
+        std::cout << "Failed to write " << path << "\n";
+    }
+    return ok;
+}
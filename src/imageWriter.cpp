@@ -0,0 +1,100 @@
+#include "ImageWriter.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+static bool endsWith(const std::string& text, const char* suffix)
+{
+    size_t length = std::strlen(suffix);
+    return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+}
+
+ImageWriter::ImageWriter(const ImageWriterSettings& settings)
+    : settings(settings)
+{
+    unsigned int threads = settings.threads;
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency() / 2);
+    }
+    this->settings.queueCapacity = std::max<size_t>(1, settings.queueCapacity);
+
+    for (unsigned int i = 0; i < threads; i++) {
+        workers.emplace_back(&ImageWriter::workerLoop, this);
+    }
+}
+
+ImageWriter::~ImageWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    jobAvailable.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void ImageWriter::submit(ImageJob&& job)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    slotAvailable.wait(lock, [this] { return queue.size() < settings.queueCapacity; });
+    queue.push_back(std::move(job));
+    lock.unlock();
+    jobAvailable.notify_one();
+}
+
+void ImageWriter::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    drained.wait(lock, [this] { return queue.empty() && busyWorkers == 0; });
+}
+
+int ImageWriter::getFailures() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return failures;
+}
+
+void ImageWriter::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        jobAvailable.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (queue.empty()) {
+            return;     // stopping and nothing left to write
+        }
+
+        ImageJob job = std::move(queue.front());
+        queue.pop_front();
+        busyWorkers++;
+        lock.unlock();
+        slotAvailable.notify_one();
+
+        bool ok = encode(job);
+
+        lock.lock();
+        busyWorkers--;
+        if (!ok) {
+            failures++;
+        }
+        if (queue.empty() && busyWorkers == 0) {
+            drained.notify_all();
+        }
+    }
+}
+
+bool ImageWriter::encode(const ImageJob& job) const
+{
+    if (endsWith(job.path, ".exr")) {
+        return writeEXR(job.path, job.width, job.height, job.rgb, settings.exrCompression);
+    }
+    if (endsWith(job.path, ".pfm")) {
+        return writePFM(job.path, job.width, job.height, job.rgb);
+    }
+    if (endsWith(job.path, ".png")) {
+        return writePNG(job.path, job.width, job.height, job.rgba8);
+    }
+    return writePPM(job.path, job.width, job.height, job.rgba8);
+}
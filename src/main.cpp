@@ -2,16 +2,32 @@
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
 #include <iostream>
 #include <vector>
+#include <memory>
 
-#include "ComputeShader.h"
-#include "demoShaderLoader.h"
 #include "Camera.h"
-
+#include "Renderer.h"
+#include "Profiler.h"
+#include "Overlay.h"
+#include "FileWatcher.h"
+#include "FramePacer.h"
+#include "DynamicResolution.h"
+#include "Headless.h"
+#include "Distributed.h"
+
+// initial window size
 const unsigned int SCR_WIDTH = 1920; //was 1024
 const unsigned int SCR_HEIGHT = 1080; //was 576
 
+// Framebuffer size, kept up to date by framebuffer_size_callback. The render targets follow
+// once it has not changed for RESIZE_DEBOUNCE seconds, not on every step of a drag-resize.
+int framebufferWidth = SCR_WIDTH;
+int framebufferHeight = SCR_HEIGHT;
+double lastResize = 0.0;
+const double RESIZE_DEBOUNCE = 0.2;
+
 // Camera
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
 float lastX = SCR_WIDTH / 2.0f;
@@ -22,38 +38,26 @@ bool firstMouse = true;
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-// Quad vertices
-float quadVertices[] = {
-    // positions        // texture coords
-    -1.0f,  1.0f, 0.0f, 0.0f, 1.0f,
-    -1.0f, -1.0f, 0.0f, 0.0f, 0.0f,
-     1.0f,  1.0f, 0.0f, 1.0f, 1.0f,
-     1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
-};
-
-// Camera data structure matching std140 layout
-struct CameraData {
-    glm::vec4 position;
-    glm::vec4 front;
-    glm::vec4 up;
-    glm::vec4 right;
-    glm::vec2 fovAndAspect;
-    glm::vec2 padding;
-};
-
-struct AccumulationData {
-    GLuint frameCount;
-    GLuint padding[3];  // For std140 layout padding
-};
-
-GLuint accumulationTexture;
-GLuint accumulationUBO;
-AccumulationData accumulationData = { 0 };
-bool shouldResetAccumulation = false;
+bool cameraMoved = false;
+
+// Tab switches between mouse look and using the cursor on the overlay
+bool mouseLook = true;
+bool tabWasDown = false;
+bool f1WasDown = false;
+
+// GPU side of the path tracer, created once the context exists
+std::unique_ptr<Renderer> renderer;
+std::unique_ptr<Profiler> profiler;
+std::unique_ptr<Overlay> overlay;
 
 // Mouse callback function
 void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
 {
+    if (!mouseLook) {
+        firstMouse = true;
+        return;
+    }
+
     float xpos = static_cast<float>(xposIn);
     float ypos = static_cast<float>(yposIn);
 
@@ -71,7 +75,14 @@ void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
     lastY = ypos;
 
     camera.ProcessMouseMovement(xoffset, yoffset);
-    shouldResetAccumulation = true;
+    cameraMoved = true;
+}
+
+void framebuffer_size_callback(GLFWwindow*, int width, int height)
+{
+    framebufferWidth = width;
+    framebufferHeight = height;
+    lastResize = glfwGetTime();
 }
 
 // Scroll callback function
@@ -85,6 +96,32 @@ void processInput(GLFWwindow* window)
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 
+    bool tabDown = glfwGetKey(window, GLFW_KEY_TAB) == GLFW_PRESS;
+    if (tabDown && !tabWasDown) {
+        mouseLook = !mouseLook;
+        glfwSetInputMode(window, GLFW_CURSOR, mouseLook ? GLFW_CURSOR_DISABLED : GLFW_CURSOR_NORMAL);
+        overlay->setMouseEnabled(!mouseLook);
+    }
+    tabWasDown = tabDown;
+
+    bool f1Down = glfwGetKey(window, GLFW_KEY_F1) == GLFW_PRESS;
+    if (f1Down && !f1WasDown) {
+        overlay->visible = !overlay->visible;
+    }
+    f1WasDown = f1Down;
+
+    // the region of interest follows the cursor while the right button is held
+    RegionOfInterest& roi = renderer->settings.regionOfInterest;
+    if (!mouseLook && roi.enabled && glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS) {
+        double x, y;
+        int width, height;
+        glfwGetCursorPos(window, &x, &y);
+        glfwGetWindowSize(window, &width, &height);
+        if (width > 0 && height > 0) {
+            roi.center = glm::vec2(x / width, 1.0 - y / height);
+        }
+    }
+
     bool cameraChanged = false;
 
     if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
@@ -108,23 +145,30 @@ void processInput(GLFWwindow* window)
     }
 
     if (cameraChanged) {
-        shouldResetAccumulation = true;
+        cameraMoved = true;
     }
         
 }
 
-void resetAccumulation() {
-    accumulationData.frameCount = 0;
-    glBindBuffer(GL_UNIFORM_BUFFER, accumulationUBO);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(AccumulationData), &accumulationData);
+int main(int argc, char** argv) {
+    HeadlessOptions headlessOptions;
+    if (!parseCommandLine(argc, argv, headlessOptions)) {
+        return -1;
+    }
+    if (!headlessOptions.mergeInputs.empty()) {
+        return runMerge(headlessOptions);
+    }
+    if (!headlessOptions.workerAddress.empty()) {
+        return runWorker(headlessOptions.workerAddress);
+    }
+    if (!headlessOptions.coordinatorAddress.empty()) {
+        return runCoordinator(headlessOptions, headlessOptions.coordinatorAddress);
+    }
+    if (headlessOptions.enabled) {
+        return runHeadless(headlessOptions);
+    }
 
-    // Clear accumulation texture
-    /*glBindTexture(GL_TEXTURE_2D, accumulationTexture);
-    std::vector<float> clearColor(SCR_WIDTH * SCR_HEIGHT * 4, 0.0f);
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, SCR_WIDTH, SCR_HEIGHT, GL_RGBA, GL_FLOAT, clearColor.data());*/
-}
 
-int main() {
     // Initialize GLFW and create window
     if (!glfwInit()) {
         std::cerr << "Failed to initialize GLFW" << std::endl;
@@ -147,6 +191,9 @@ int main() {
     // Set callbacks
     glfwSetCursorPosCallback(window, mouse_callback);
     glfwSetScrollCallback(window, scroll_callback);
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    // differs from the window size on high DPI displays
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
 
     // Capture mouse
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
@@ -157,131 +204,118 @@ int main() {
         return -1;
     }
 
-    //Compute shader
-    ComputeShader computeShader(RESOURCES_PATH"raytracer.cs");
-
-    //Quad shader
-    Shader quadShader;
-    quadShader.loadShaderProgramFromFile(RESOURCES_PATH "vert.vert", RESOURCES_PATH "frag.frag");
-    quadShader.use();
-
-    // Create VAO for quad
-    GLuint quadVAO, quadVBO;
-    glGenVertexArrays(1, &quadVAO);
-    glGenBuffers(1, &quadVBO);
-    glBindVertexArray(quadVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
-
-    // Create texture for compute shader output
-    GLuint outputTexture;
-    glGenTextures(1, &outputTexture);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, outputTexture);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, nullptr);
-    glBindImageTexture(0, outputTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
-
-
-    // Create accumulation texture
-    glGenTextures(1, &accumulationTexture);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, accumulationTexture);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, nullptr);
-    glBindImageTexture(1, accumulationTexture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
-
-    // Create and setup camera UBO
-    GLuint cameraUBO;
-    glGenBuffers(1, &cameraUBO);
-    glBindBuffer(GL_UNIFORM_BUFFER, cameraUBO);
-    glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraData), nullptr, GL_DYNAMIC_DRAW);
-
-    // Create accumulation UBO
-    glGenBuffers(1, &accumulationUBO);
-    glBindBuffer(GL_UNIFORM_BUFFER, accumulationUBO);
-    glBufferData(GL_UNIFORM_BUFFER, sizeof(AccumulationData), &accumulationData, GL_DYNAMIC_DRAW);
-    glBindBufferBase(GL_UNIFORM_BUFFER, 1, accumulationUBO);
-
-    // Get the uniform block index and bind it explicitly
-    GLuint blockIndex = glGetUniformBlockIndex(computeShader.ID, "CameraBlock");
-    if (blockIndex == GL_INVALID_INDEX) {
-        std::cout << "Failed to find CameraBlock uniform block" << std::endl;
+    // Shader variants compile on a hidden window sharing the main context's objects
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* compileWindow = glfwCreateWindow(1, 1, "", nullptr, window);
+    std::unique_ptr<ShaderCompiler> shaderCompiler;
+    if (compileWindow) {
+        shaderCompiler = std::make_unique<ShaderCompiler>(
+            [compileWindow] { glfwMakeContextCurrent(compileWindow); },
+            [] { glfwMakeContextCurrent(nullptr); });
     }
     else {
-        std::cout << "Found CameraBlock at index: " << blockIndex << std::endl;
-        glUniformBlockBinding(computeShader.ID, blockIndex, 0);
-        glBindBufferBase(GL_UNIFORM_BUFFER, 0, cameraUBO);
+        std::cout << "No shared context, shader variants compile on the render thread" << std::endl;
     }
 
-    float aspect = (float)SCR_WIDTH / (float)SCR_HEIGHT;
+    // edited compute shaders are recompiled and swapped in without a restart
+    FileWatcher shaderWatcher(RESOURCES_PATH);
+
+    int renderWidth = framebufferWidth, renderHeight = framebufferHeight;
+    renderer = std::make_unique<Renderer>(renderWidth, renderHeight);
+    profiler = std::make_unique<Profiler>();
+    renderer->setProfiler(profiler.get());
+    renderer->setShaderCompiler(shaderCompiler.get());
+    renderer->settings.collectRayStats = headlessOptions.rayStats;
+    FrameRayStats rayStats;
+    // after our callbacks, ImGui chains them
+    overlay = std::make_unique<Overlay>(window);
+    overlay->setMouseEnabled(!mouseLook);
+    overlay->dynamicResolution = headlessOptions.targetFps > 0;
+    if (headlessOptions.targetFps > 0) {
+        overlay->targetFps = headlessOptions.targetFps;
+    }
+    DynamicResolution dynamicResolution;
+    float lastReport = 0.0f;
+    FramePacer pacer(headlessOptions.framesInFlight > 0 ? headlessOptions.framesInFlight : 1);
+    pacer.setProfiler(profiler.get());
 
     // Main render loop
     while (!glfwWindowShouldClose(window)) {
+        // Input is read once the GPU has room for the frame, so it shows up as soon as possible
+        pacer.beginFrame();
+        glfwPollEvents();
+        pacer.inputSampled();
+
         // Calculate delta time
         float currentFrame = static_cast<float>(glfwGetTime());
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
+        profiler->beginFrame();
+        profiler->addCpu("frame", deltaTime * 1000.0);
 
         // Process input
         processInput(window);
 
-        // Update camera data
-        CameraData cameraData;
-        cameraData.position = glm::vec4(camera.Position, 1.0f);
-        cameraData.front = glm::vec4(camera.Front, 0.0f);
-        cameraData.up = glm::vec4(camera.Up, 0.0f);
-        cameraData.right = glm::vec4(camera.Right, 0.0f);
-        cameraData.fovAndAspect = glm::vec2(glm::radians(camera.Zoom), aspect);
-        cameraData.padding = glm::vec2(0.0f);
-
-        // Update camera UBO
-        glBindBuffer(GL_UNIFORM_BUFFER, cameraUBO);
-        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(CameraData), &cameraData);
-
-        if (shouldResetAccumulation) {
-            resetAccumulation();
-            shouldResetAccumulation = false;
+        // A minimized window has no framebuffer, the last size stays until it comes back.
+        // Meanwhile present() stretches the last render over the resized window.
+        bool resizeSettled = currentFrame - lastResize >= RESIZE_DEBOUNCE;
+        if (resizeSettled && framebufferWidth > 0 && framebufferHeight > 0) {
+            renderWidth = framebufferWidth;
+            renderHeight = framebufferHeight;
         }
 
-        accumulationData.frameCount++;
-        glBindBuffer(GL_UNIFORM_BUFFER, accumulationUBO);
-        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(AccumulationData), &accumulationData);
-
-        // Dispatch compute shader
-        computeShader.use();
-        glDispatchCompute((SCR_WIDTH + 15) / 16, (SCR_HEIGHT + 15) / 16, 1);
-        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
-
-        // Render quad with computed texture
-        glClear(GL_COLOR_BUFFER_BIT);
-        quadShader.use();
-        glBindVertexArray(quadVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, outputTexture);
-        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        // present() upsamples a reduced render resolution to the window
+        float scale = overlay->resolutionScale;
+        if (overlay->dynamicResolution) {
+            dynamicResolution.setTarget(1000.0 / std::max(overlay->targetFps, 1));
+            dynamicResolution.setRange(0.25f, overlay->resolutionScale);
+            scale = dynamicResolution.getScale();
+        }
+        renderer->resize(std::max(1, static_cast<int>(renderWidth * scale)), std::max(1, static_cast<int>(renderHeight * scale)));
+        dynamicResolution.beginFrame();
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        if (shaderWatcher.poll()) {
+            renderer->reloadShaders();
+        }
+        renderer->setCamera(camera);
+        renderer->render(cameraMoved);
+        cameraMoved = false;
+        while (renderer->readRayStats(rayStats)) {}
+
+        // Resolve the accumulation into the sRGB target and present it
+        renderer->resolve();
+        renderer->present(framebufferWidth, framebufferHeight);
+        overlay->draw(*renderer, *profiler, rayStats, pacer);
+        dynamicResolution.endFrame();
+
+        {
+            ScopedCpuTimer timer(profiler.get(), "swap");
+            glfwSwapBuffers(window);
+        }
+        pacer.endFrame();
+        profiler->endFrame();
+
+        if ((headlessOptions.profile || headlessOptions.rayStats) && currentFrame - lastReport > 5.0f) {
+            if (headlessOptions.profile) {
+                profiler->print(std::cout);
+            }
+            if (rayStats.frame > 0) {
+                std::cout << "frame " << rayStats.frame << ": " << rayStats.mraysPerSecond() << " Mrays/s, average path depth "
+                    << rayStats.averagePathDepth() << "\n";
+            }
+            lastReport = currentFrame;
+        }
     }
 
-    // Cleanup
-    glDeleteVertexArrays(1, &quadVAO);
-    glDeleteBuffers(1, &quadVBO);
-    glDeleteTextures(1, &outputTexture);
-    glDeleteBuffers(1, &cameraUBO);
-    glDeleteTextures(1, &accumulationTexture);
-    glDeleteBuffers(1, &accumulationUBO);
+    // Cleanup, the renderer's GL objects have to go before the context
+    pacer.finish();
+    overlay.reset();
+    renderer.reset();
+    profiler.reset();
+    shaderCompiler.reset();
+    if (compileWindow) {
+        glfwDestroyWindow(compileWindow);
+    }
 
     glfwTerminate();
     return 0;
@@ -0,0 +1,175 @@
+#include "Overlay.h"
+
+#include <GLFW/glfw3.h>
+#include <imgui.h>
+#include <backends/imgui_impl_glfw.h>
+#include <backends/imgui_impl_opengl3.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+// GL_NVX_gpu_memory_info, not part of the generated loader
+static const GLenum GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX = 0x9048;
+static const GLenum GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX = 0x9049;
+
+static const size_t MRAYS_HISTORY = 256;
+
+Overlay::Overlay(GLFWwindow* window)
+{
+    IMGUI_CHECKVERSION();
+    ImGui::CreateContext();
+    ImGui::GetIO().IniFilename = nullptr;
+    ImGui::StyleColorsDark();
+    ImGui_ImplGlfw_InitForOpenGL(window, true);
+    ImGui_ImplOpenGL3_Init("#version 430");
+
+    GLint extensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensions);
+    for (GLint i = 0; i < extensions; i++) {
+        const char* name = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (name && std::strcmp(name, "GL_NVX_gpu_memory_info") == 0) {
+            hasMemoryInfo = true;
+        }
+    }
+}
+
+Overlay::~Overlay()
+{
+    ImGui_ImplOpenGL3_Shutdown();
+    ImGui_ImplGlfw_Shutdown();
+    ImGui::DestroyContext();
+}
+
+void Overlay::setMouseEnabled(bool enabled)
+{
+    ImGuiIO& io = ImGui::GetIO();
+    if (enabled) {
+        io.ConfigFlags &= ~ImGuiConfigFlags_NoMouse;
+    }
+    else {
+        io.ConfigFlags |= ImGuiConfigFlags_NoMouse;
+    }
+}
+
+void Overlay::plot(const char* label, const std::vector<float>& samples, const char* unit)
+{
+    if (samples.empty()) {
+        return;
+    }
+    float top = *std::max_element(samples.begin(), samples.end());
+    char overlay[64];
+    std::snprintf(overlay, sizeof(overlay), "%.2f %s (max %.2f)", samples.back(), unit, top);
+    ImGui::PlotLines(label, samples.data(), (int)samples.size(), 0, overlay, 0.0f, top * 1.1f + 1e-6f, ImVec2(0, 60));
+}
+
+void Overlay::draw(Renderer& renderer, const Profiler& profiler, const FrameRayStats& rayStats, FramePacer& pacer)
+{
+    mraysHistory.push_back((float)rayStats.mraysPerSecond());
+    if (mraysHistory.size() > MRAYS_HISTORY) {
+        mraysHistory.pop_front();
+    }
+
+    if (!visible) {
+        return;
+    }
+
+    ImGui_ImplOpenGL3_NewFrame();
+    ImGui_ImplGlfw_NewFrame();
+    ImGui::NewFrame();
+
+    ImGui::SetNextWindowPos(ImVec2(10, 10), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowSize(ImVec2(420, 0), ImGuiCond_FirstUseEver);
+    ImGui::Begin("Performance");
+
+    RenderSettings& settings = renderer.settings;
+    ImGui::Text("%d x %d, %u frames, %u spp", renderer.getWidth(), renderer.getHeight(),
+        renderer.getFrameCount(), renderer.getFrameCount() * (unsigned)settings.samplesPerFrame);
+    if (settings.collectRayStats && rayStats.frame > 0) {
+        ImGui::Text("%.1f Mrays/s, average path depth %.2f", rayStats.mraysPerSecond(), rayStats.averagePathDepth());
+    }
+    ImGui::Text("Input latency %.1f ms, %d frame(s) in flight", pacer.getLastLatency(), pacer.getMaxFramesInFlight());
+    ImGui::Text("Textures: %.1f MB", renderer.getTextureMemory() / (1024.0 * 1024.0));
+    if (hasMemoryInfo) {
+        GLint total = 0, available = 0;
+        glGetIntegerv(GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX, &total);
+        glGetIntegerv(GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, &available);
+        ImGui::Text("GPU memory: %.0f / %.0f MB used", (total - available) / 1024.0, total / 1024.0);
+    }
+
+    if (ImGui::CollapsingHeader("Timings", ImGuiTreeNodeFlags_DefaultOpen)) {
+        profiler.getHistory("frame", false, history);
+        plot("frame", history, "ms");
+        profiler.getHistory("trace", true, history);
+        plot("trace (GPU)", history, "ms");
+        if (settings.collectRayStats) {
+            history.assign(mraysHistory.begin(), mraysHistory.end());
+            plot("Mrays/s", history, "");
+        }
+
+        if (ImGui::BeginTable("passes", 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp)) {
+            ImGui::TableSetupColumn("pass");
+            ImGui::TableSetupColumn("avg ms");
+            ImGui::TableSetupColumn("p50");
+            ImGui::TableSetupColumn("p95");
+            ImGui::TableSetupColumn("p99");
+            ImGui::TableHeadersRow();
+            for (const ProfileStats& entry : profiler.getStats()) {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::Text("%s %s", entry.gpu ? "gpu" : "cpu", entry.name.c_str());
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", entry.average);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", entry.p50);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", entry.p95);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", entry.p99);
+            }
+            ImGui::EndTable();
+        }
+    }
+
+    if (ImGui::CollapsingHeader("Settings", ImGuiTreeNodeFlags_DefaultOpen)) {
+        // compiled into the trace shader, the renderer resets once the new variant is in
+        ImGui::SliderInt("samples per frame", &settings.samplesPerFrame, 1, 16);
+        ImGui::SliderInt("max bounces", &settings.maxBounces, 1, 100);
+        ImGui::Checkbox("metal sphere", &settings.sceneHasMetal);
+        ImGui::SameLine();
+        ImGui::Checkbox("glass sphere", &settings.sceneHasGlass);
+        RegionOfInterest& roi = settings.regionOfInterest;
+        ImGui::Checkbox("region of interest", &roi.enabled);
+        if (roi.enabled) {
+            ImGui::SameLine();
+            ImGui::TextDisabled("(right click to move)");
+            ImGui::SliderFloat("roi radius", &roi.radius, 0.05f, 1.0f, "%.2f");
+            ImGui::SliderInt("periphery samples", &roi.peripherySamples, 1, settings.samplesPerFrame);
+            ImGui::SliderInt("periphery every nth frame", &roi.peripheryPeriod, 1, 8);
+        }
+        int framesInFlight = pacer.getMaxFramesInFlight();
+        if (ImGui::SliderInt("frames in flight", &framesInFlight, 1, 4)) {
+            pacer.setMaxFramesInFlight(framesInFlight);
+        }
+        // applied by the frame loop, which resizes the renderer
+        ImGui::SliderFloat(dynamicResolution ? "max resolution scale" : "resolution scale", &resolutionScale, 0.25f, 1.0f, "%.2f");
+        ImGui::Checkbox("dynamic resolution", &dynamicResolution);
+        if (dynamicResolution) {
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(120);
+            ImGui::SliderInt("target fps", &targetFps, 15, 240);
+        }
+        ImGui::Checkbox("ray statistics", &settings.collectRayStats);
+        ImGui::Checkbox("temporal reprojection", &settings.temporalReprojection);
+        // the denoiser needs moments accumulated from the first frame on
+        if (ImGui::Checkbox("denoiser", &settings.denoiser.enabled)) {
+            renderer.resetAccumulation();
+        }
+        ImGui::SliderFloat("exposure", &settings.exposure, 0.1f, 8.0f, "%.2f", ImGuiSliderFlags_Logarithmic);
+    }
+    ImGui::TextDisabled("Tab: toggle mouse look, F1: hide");
+
+    ImGui::End();
+    ImGui::Render();
+    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+}
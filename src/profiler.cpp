@@ -0,0 +1,171 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+Profiler::Profiler(int latency, size_t window)
+    : window(std::max<size_t>(window, 1)), frames(std::max(latency, 1) + 1), frame(0), dropped(0), gpuActive(false)
+{
+}
+
+Profiler::~Profiler()
+{
+    for (FrameQueries& queries : frames) {
+        if (!queries.pool.empty()) {
+            glDeleteQueries((GLsizei)queries.pool.size(), queries.pool.data());
+        }
+    }
+}
+
+void Profiler::beginFrame()
+{
+    // the slot this frame reuses was filled latency frames ago
+    collect(frames[frame % frames.size()]);
+}
+
+void Profiler::endFrame()
+{
+    if (gpuActive) {
+        endGpu();
+    }
+    frame++;
+}
+
+void Profiler::beginGpu(const char* name)
+{
+    if (gpuActive) {
+        endGpu();
+    }
+
+    FrameQueries& queries = frames[frame % frames.size()];
+    if (queries.pending.size() == queries.pool.size()) {
+        GLuint query;
+        glGenQueries(1, &query);
+        queries.pool.push_back(query);
+    }
+    GLuint query = queries.pool[queries.pending.size()];
+    queries.pending.push_back({ query, findSection(name, true) });
+    glBeginQuery(GL_TIME_ELAPSED, query);
+    gpuActive = true;
+}
+
+void Profiler::endGpu()
+{
+    if (gpuActive) {
+        glEndQuery(GL_TIME_ELAPSED);
+        gpuActive = false;
+    }
+}
+
+void Profiler::addCpu(const char* name, double milliseconds)
+{
+    record(findSection(name, false), milliseconds);
+}
+
+void Profiler::collect(FrameQueries& queries)
+{
+    for (const PendingQuery& pending : queries.pending) {
+        GLint available = 0;
+        glGetQueryObjectiv(pending.query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            dropped++;
+            continue;
+        }
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(pending.query, GL_QUERY_RESULT, &nanoseconds);
+        record(pending.section, double(nanoseconds) * 1e-6);
+    }
+    queries.pending.clear();
+}
+
+size_t Profiler::findSection(const char* name, bool gpu)
+{
+    for (size_t i = 0; i < sections.size(); i++) {
+        if (sections[i].gpu == gpu && sections[i].name == name) {
+            return i;
+        }
+    }
+    sections.emplace_back(name, gpu);
+    sections.back().samples.reserve(window);
+    return sections.size() - 1;
+}
+
+void Profiler::record(size_t index, double milliseconds)
+{
+    Section& section = sections[index];
+    if (section.samples.size() < window) {
+        section.samples.push_back((float)milliseconds);
+    }
+    else {
+        section.samples[section.next] = (float)milliseconds;
+    }
+    section.next = (section.next + 1) % window;
+    section.last = milliseconds;
+}
+
+std::vector<ProfileStats> Profiler::getStats() const
+{
+    std::vector<ProfileStats> stats;
+    std::vector<float> sorted;
+    for (const Section& section : sections) {
+        ProfileStats entry;
+        entry.name = section.name;
+        entry.gpu = section.gpu;
+        entry.samples = section.samples.size();
+        entry.last = section.last;
+        if (!section.samples.empty()) {
+            sorted = section.samples;
+            std::sort(sorted.begin(), sorted.end());
+            double sum = 0.0;
+            for (float sample : sorted) {
+                sum += sample;
+            }
+            // nearest rank
+            auto percentile = [&](double p) {
+                size_t rank = (size_t)std::ceil(p * sorted.size());
+                return (double)sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+            };
+            entry.average = sum / sorted.size();
+            entry.p50 = percentile(0.50);
+            entry.p95 = percentile(0.95);
+            entry.p99 = percentile(0.99);
+            entry.max = sorted.back();
+        }
+        stats.push_back(entry);
+    }
+    return stats;
+}
+
+void Profiler::getHistory(const char* name, bool gpu, std::vector<float>& samples) const
+{
+    samples.clear();
+    for (const Section& section : sections) {
+        if (section.gpu == gpu && section.name == name) {
+            // once the ring is full, next is also the oldest sample
+            size_t start = section.samples.size() < window ? 0 : section.next;
+            samples.insert(samples.end(), section.samples.begin() + start, section.samples.end());
+            samples.insert(samples.end(), section.samples.begin(), section.samples.begin() + start);
+            return;
+        }
+    }
+}
+
+void Profiler::print(std::ostream& out) const
+{
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(3);
+    out << "pass                      avg ms   p50 ms   p95 ms   p99 ms   max ms  samples\n";
+    for (const ProfileStats& entry : getStats()) {
+        std::string label = (entry.gpu ? "gpu " : "cpu ") + entry.name;
+        out << std::left << std::setw(22) << label << std::right
+            << std::setw(11) << entry.average << std::setw(9) << entry.p50 << std::setw(9) << entry.p95
+            << std::setw(9) << entry.p99 << std::setw(9) << entry.max << std::setw(9) << entry.samples << "\n";
+    }
+    if (dropped > 0) {
+        out << dropped << " GPU queries were not ready in time and got dropped\n";
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
@@ -0,0 +1,237 @@
+#include "ProgramCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <vector>
+
+static const uint32_t PROGRAM_CACHE_MAGIC = 0x42505452;  // "RTPB"
+static const uint32_t PROGRAM_CACHE_VERSION = 1;
+// Every edit of a hot-reloaded shader adds an entry, the least recently used ones beyond this
+// are deleted whenever one is stored
+static const uint64_t PROGRAM_CACHE_MAX_BYTES = 64ull << 20;
+
+struct ProgramCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t binaryFormat;
+    uint32_t size;
+};
+
+static std::mutex cacheMutex;
+static bool directoryResolved = false;
+static std::string cacheDirectory;
+
+static std::string defaultCacheDirectory()
+{
+    const char* configured = std::getenv("RAYTRACER_SHADER_CACHE");
+    if (configured) {
+        return std::strcmp(configured, "off") == 0 ? std::string() : std::string(configured);
+    }
+#ifdef _WIN32
+    const char* base = std::getenv("LOCALAPPDATA");
+    return base ? std::string(base) + "\\raytracer\\shaders" : std::string();
+#else
+    const char* xdg = std::getenv("XDG_CACHE_HOME");
+    if (xdg && *xdg) {
+        return std::string(xdg) + "/raytracer/shaders";
+    }
+    const char* home = std::getenv("HOME");
+    return home ? std::string(home) + "/.cache/raytracer/shaders" : std::string();
+#endif
+}
+
+void setProgramCacheDirectory(const std::string& directory)
+{
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    cacheDirectory = directory;
+    directoryResolved = true;
+}
+
+std::string getProgramCacheDirectory()
+{
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (!directoryResolved) {
+        cacheDirectory = defaultCacheDirectory();
+        directoryResolved = true;
+    }
+    return cacheDirectory;
+}
+
+// FNV-1a, good enough to tell sources apart and stable across platforms
+static void hashBytes(uint64_t& hash, const void* data, size_t size)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+}
+
+static void hashString(uint64_t& hash, const char* text)
+{
+    // the terminator separates consecutive strings
+    hashBytes(hash, text ? text : "", text ? std::strlen(text) + 1 : 1);
+}
+
+uint64_t programCacheKey(int count, const GLenum* types, const char* const* sources)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    hashString(hash, (const char*)glGetString(GL_VENDOR));
+    hashString(hash, (const char*)glGetString(GL_RENDERER));
+    hashString(hash, (const char*)glGetString(GL_VERSION));
+    for (int i = 0; i < count; i++) {
+        uint32_t type = types[i];
+        hashBytes(hash, &type, sizeof(type));
+        hashString(hash, sources[i]);
+    }
+    return hash;
+}
+
+static std::string entryPath(const std::string& directory, uint64_t key)
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+    return (std::filesystem::path(directory) / name).string();
+}
+
+GLuint loadCachedProgram(uint64_t key)
+{
+    std::string directory = getProgramCacheDirectory();
+    if (directory.empty()) {
+        return 0;
+    }
+
+    std::string path = entryPath(directory, key);
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        return 0;
+    }
+    ProgramCacheHeader header;
+    std::vector<char> binary;
+    bool ok = std::fread(&header, sizeof(header), 1, file) == 1
+        && header.magic == PROGRAM_CACHE_MAGIC && header.version == PROGRAM_CACHE_VERSION && header.key == key;
+    if (ok) {
+        // a corrupt size must not turn into a huge allocation, the binary is the rest of the file
+        long start = std::ftell(file);
+        ok = std::fseek(file, 0, SEEK_END) == 0 && start >= 0
+            && (uint64_t)(std::ftell(file) - start) == (uint64_t)header.size
+            && std::fseek(file, start, SEEK_SET) == 0;
+    }
+    if (ok) {
+        binary.resize(header.size);
+        ok = std::fread(binary.data(), 1, binary.size(), file) == binary.size();
+    }
+    std::fclose(file);
+
+    GLint linked = GL_FALSE;
+    GLuint program = 0;
+    if (ok) {
+        program = glCreateProgram();
+        glProgramBinary(program, header.binaryFormat, binary.data(), (GLsizei)binary.size());
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    }
+    if (!linked) {
+        // a driver may still refuse a binary of its own, recompiling replaces the entry
+        if (program) {
+            glDeleteProgram(program);
+        }
+        std::remove(path.c_str());
+        return 0;
+    }
+    // marks the entry as used for the eviction in storeCachedProgram
+    std::error_code error;
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+    return program;
+}
+
+// Deletes the least recently used entries until the rest fit into PROGRAM_CACHE_MAX_BYTES.
+// Another launch may be pruning at the same time, so failures are ignored.
+static void pruneCache(const std::string& directory)
+{
+    struct Entry
+    {
+        std::filesystem::path path;
+        std::filesystem::file_time_type used;
+        uint64_t size;
+    };
+    std::vector<Entry> entries;
+    uint64_t total = 0;
+    std::error_code error;
+    for (std::filesystem::directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+        if (it->path().extension() != ".bin") {
+            continue;
+        }
+        std::error_code entryError;
+        Entry entry = { it->path(), it->last_write_time(entryError), 0 };
+        entry.size = entryError ? 0 : (uint64_t)it->file_size(entryError);
+        if (!entryError) {
+            total += entry.size;
+            entries.push_back(entry);
+        }
+    }
+    if (total <= PROGRAM_CACHE_MAX_BYTES) {
+        return;
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.used < b.used; });
+    for (const Entry& entry : entries) {
+        if (total <= PROGRAM_CACHE_MAX_BYTES) {
+            break;
+        }
+        std::filesystem::remove(entry.path, error);
+        total -= entry.size;
+    }
+}
+
+void storeCachedProgram(uint64_t key, GLuint program)
+{
+    std::string directory = getProgramCacheDirectory();
+    if (directory.empty()) {
+        return;
+    }
+
+    GLint size = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+    if (size <= 0) {
+        return;     // the driver offers no binary formats
+    }
+    ProgramCacheHeader header = { PROGRAM_CACHE_MAGIC, PROGRAM_CACHE_VERSION, key, 0, 0 };
+    std::vector<char> binary(size);
+    GLenum format = 0;
+    glGetProgramBinary(program, size, &size, &format, binary.data());
+    header.binaryFormat = format;
+    header.size = (uint32_t)size;
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        std::cout << "Cannot create shader cache directory " << directory << ": " << error.message() << "\n";
+        return;
+    }
+
+    // written under a temporary name, a concurrent launch never reads half an entry
+    std::string path = entryPath(directory, key);
+    std::string temporary = path + "." + std::to_string(std::random_device()()) + ".tmp";
+    FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (!file) {
+        return;
+    }
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1
+        && std::fwrite(binary.data(), 1, header.size, file) == header.size;
+    ok = std::fclose(file) == 0 && ok;
+    if (ok) {
+        std::filesystem::rename(temporary, path, error);
+    }
+    if (!ok || error) {
+        std::remove(temporary.c_str());
+        return;
+    }
+    pruneCache(directory);
+}
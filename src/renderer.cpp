@@ -0,0 +1,366 @@
+#include "Renderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+// Quad vertices
+static const float quadVertices[] = {
+    // positions        // texture coords
+    -1.0f,  1.0f, 0.0f, 0.0f, 1.0f,
+    -1.0f, -1.0f, 0.0f, 0.0f, 0.0f,
+     1.0f,  1.0f, 0.0f, 1.0f, 1.0f,
+     1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
+};
+
+Renderer::Renderer(int width, int height)
+    : width(width), height(height), tileOffset(0), imageResolution(width, height), frameOffset(0), profiler(nullptr),
+    shaderCompiler(nullptr), traceVariants(RESOURCES_PATH "raytracer.cs"), activeDefines(traceDefines()), activeGeneration(0),
+    activeBudgetSamples(0), activeCountsRays(false),
+    computeShader(traceVariants.select(activeDefines)),
+    reprojectVariants(RESOURCES_PATH "reproject.cs"),
+    reprojectShader(reprojectVariants.select(ShaderDefines())),
+    accumulationData{ 0, 0, 0, 0 }, firstFrame(true), shouldResetAccumulation(false), displayTexture(0)
+{
+    cacheActiveDefines();
+
+    //Quad shader
+    quadShader.loadShaderProgramFromFile(RESOURCES_PATH "vert.vert", RESOURCES_PATH "frag.frag");
+
+    // Per-frame uniforms, resolved again whenever a pass switches programs
+    tileOffsetUniform = computeShader.uniformHandle("tileOffset");
+    imageResolutionUniform = computeShader.uniformHandle("imageResolution");
+    frameIndexUniform = computeShader.uniformHandle("frameIndex");
+    collectStatsUniform = computeShader.uniformHandle("collectStats");
+    exposureUniform = quadShader.getHandle("exposure");
+    tonemapOperatorUniform = quadShader.getHandle("tonemapOperator");
+
+    // Create VAO for quad
+    glGenVertexArrays(1, &quadVAO);
+    glGenBuffers(1, &quadVBO);
+    glBindVertexArray(quadVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+
+    // Create ping-pong accumulation textures and the sRGB target they are resolved into
+    accumulation = std::make_unique<AccumulationBuffer>(width, height);
+    resolveTarget = std::make_unique<ResolveTarget>(width, height);
+    gbuffer = std::make_unique<GBuffer>(width, height);
+    denoiser = std::make_unique<Denoiser>(width, height);
+    std::cout << "Accumulation image traffic: " << accumulation->bytesPerPixel() << " bytes/pixel/frame ("
+        << (accumulation->bytesPerPixel() * width * height) / (1024 * 1024) << " MB)" << std::endl;
+
+    // Camera and accumulation blocks are streamed every frame, to the bindings the shader declares
+    frameUniforms = std::make_unique<UniformRing>(sizeof(CameraData) + sizeof(AccumulationData));
+    cameraBinding = computeShader.reflection.uniformBlockBinding("CameraBlock");
+    accumulationBinding = computeShader.reflection.uniformBlockBinding("AccumulationBlock");
+    if (cameraBinding < 0 || accumulationBinding < 0) {
+        std::cout << "Failed to find CameraBlock or AccumulationBlock uniform block" << std::endl;
+    }
+    else {
+        std::cout << "Found CameraBlock at binding: " << cameraBinding << std::endl;
+    }
+}
+
+Renderer::~Renderer()
+{
+    glDeleteVertexArrays(1, &quadVAO);
+    glDeleteBuffers(1, &quadVBO);
+    quadShader.clear();
+}
+
+void Renderer::setCamera(const Camera& camera)
+{
+    float aspect = (float)imageResolution.x / (float)imageResolution.y;
+
+    // Update camera data, keeping last frame's camera for reprojection
+    cameraData.previous = cameraData.current;
+    cameraData.current.position = glm::vec4(camera.Position, 1.0f);
+    cameraData.current.front = glm::vec4(camera.Front, 0.0f);
+    cameraData.current.up = glm::vec4(camera.Up, 0.0f);
+    cameraData.current.right = glm::vec4(camera.Right, 0.0f);
+    cameraData.current.fovAndAspect = glm::vec2(glm::radians(camera.Zoom), aspect);
+    cameraData.current.padding = glm::vec2(0.0f);
+    if (firstFrame) {
+        cameraData.previous = cameraData.current;
+        firstFrame = false;
+    }
+}
+
+void Renderer::reloadShaders()
+{
+    traceVariants.reload();
+    reprojectVariants.reload();
+    denoiser->reloadShaders(shaderCompiler);
+}
+
+ShaderDefines Renderer::traceDefines() const
+{
+    ShaderDefines defines;
+    defines["SAMPLES"] = std::to_string(std::max(settings.samplesPerFrame, 1));
+    defines["MAX_BOUNCES"] = std::to_string(std::max(settings.maxBounces, 1));
+    defines["RAY_STATS"] = settings.collectRayStats ? "1" : "0";
+    defines["SCENE_HAS_METAL"] = settings.sceneHasMetal ? "1" : "0";
+    defines["SCENE_HAS_GLASS"] = settings.sceneHasGlass ? "1" : "0";
+    defines["SAMPLE_BUDGET"] = settings.regionOfInterest.enabled ? "1" : "0";
+    return defines;
+}
+
+void Renderer::cacheActiveDefines()
+{
+    activeBudgetSamples = activeDefines["SAMPLE_BUDGET"] == "1" ? std::stoi(activeDefines["SAMPLES"]) : 0;
+    activeCountsRays = activeDefines["RAY_STATS"] == "1";
+}
+
+void Renderer::resetAccumulation()
+{
+    shouldResetAccumulation = true;
+}
+
+void Renderer::resize(int width, int height)
+{
+    if (width == this->width && height == this->height) {
+        return;
+    }
+    this->width = width;
+    this->height = height;
+    tileOffset = glm::ivec2(0);
+    imageResolution = glm::ivec2(width, height);
+    accumulation = std::make_unique<AccumulationBuffer>(width, height);
+    resolveTarget = std::make_unique<ResolveTarget>(width, height);
+    gbuffer = std::make_unique<GBuffer>(width, height);
+    denoiser->resize(width, height);
+    displayTexture = accumulation->resultTexture();
+    shouldResetAccumulation = true;
+}
+
+void Renderer::restoreAccumulation(GLuint frameCount, const std::vector<float>& rgba, const std::vector<float>& moments)
+{
+    accumulation->upload(rgba.data(), moments.empty() ? nullptr : moments.data());
+    accumulationData.frameCount = frameCount;
+    shouldResetAccumulation = false;
+}
+
+void Renderer::setTile(int x, int y, int imageWidth, int imageHeight)
+{
+    tileOffset = glm::ivec2(x, y);
+    imageResolution = glm::ivec2(imageWidth, imageHeight);
+    shouldResetAccumulation = true;
+}
+
+void Renderer::render(bool cameraMoved)
+{
+    ScopedCpuTimer cpuTimer(profiler, "render submit");
+
+    // Variants for changed settings or edited files, the active one stays until they are compiled
+    ShaderDefines defines = traceDefines();
+    GLuint program = traceVariants.select(defines, shaderCompiler);
+    if (program != computeShader.ID) {
+        // only the statistics leave the image alone
+        ShaderDefines image = defines, activeImage = activeDefines;
+        image.erase("RAY_STATS");
+        activeImage.erase("RAY_STATS");
+        if (image != activeImage || traceVariants.getGeneration() != activeGeneration) {
+            shouldResetAccumulation = true;
+        }
+        computeShader.setProgram(program);
+        activeDefines = defines;
+        activeGeneration = traceVariants.getGeneration();
+        cacheActiveDefines();
+    }
+    reprojectShader.setProgram(reprojectVariants.select(ShaderDefines(), shaderCompiler));
+
+    accumulationData.reprojectHistory = 0;
+    if (cameraMoved) {
+        if (settings.temporalReprojection) {
+            accumulationData.reprojectHistory = 1;
+        }
+        else {
+            shouldResetAccumulation = true;
+        }
+    }
+
+    if (shouldResetAccumulation) {
+        // The shader ignores the history texture when frameCount == 1, so there is nothing to clear
+        accumulationData.frameCount = 0;
+        shouldResetAccumulation = false;
+    }
+
+    accumulationData.frameCount++;
+    accumulationData.maxHistoryFrames = settings.maxHistoryFrames;
+    accumulationData.accumulateMoments = settings.denoiser.enabled ? 1 : 0;
+    {
+        ScopedCpuTimer timer(profiler, "uniform upload");
+        frameUniforms->beginFrame();
+        frameUniforms->upload(cameraBinding, &cameraData, sizeof(CameraData));
+        frameUniforms->upload(accumulationBinding, &accumulationData, sizeof(AccumulationData));
+    }
+
+    // Dispatch compute shader
+    {
+        ScopedGpuTimer timer(profiler, "trace");
+        computeShader.use();
+        computeShader.setIVec2(tileOffsetUniform, tileOffset.x, tileOffset.y);
+        computeShader.setIVec2(imageResolutionUniform, imageResolution.x, imageResolution.y);
+        computeShader.setUInt(frameIndexUniform, frameOffset + accumulationData.frameCount);
+        accumulation->bindForDispatch();
+        gbuffer->bindForDispatch();
+        if (activeBudgetSamples > 0) {
+            if (!sampleBudget) {
+                sampleBudget = std::make_unique<SampleBudget>();
+            }
+            sampleBudget->update(imageResolution.x, imageResolution.y, settings.regionOfInterest, activeBudgetSamples);
+            sampleBudget->bind();
+        }
+
+        // a variant without RAY_STATS has no counters to read
+        if (activeCountsRays && !rayStats) {
+            rayStats = std::make_unique<RayStatsRing>();
+        }
+        bool counting = activeCountsRays && rayStats->begin(frameOffset + accumulationData.frameCount);
+        if (activeCountsRays) {
+            computeShader.setBool(collectStatsUniform, counting);
+        }
+        glDispatchCompute((width + 15) / 16, (height + 15) / 16, 1);
+        if (counting) {
+            rayStats->end();
+        }
+    }
+
+    // Merge the reprojected history with this frame's samples
+    if (accumulationData.reprojectHistory) {
+        ScopedGpuTimer timer(profiler, "reproject");
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        reprojectShader.use();
+        glDispatchCompute((width + 15) / 16, (height + 15) / 16, 1);
+    }
+
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+    accumulation->swap();
+    gbuffer->swap();
+
+    displayTexture = accumulation->resultTexture();
+    if (settings.denoiser.enabled) {
+        ScopedGpuTimer timer(profiler, "denoise");
+        displayTexture = denoiser->denoise(*accumulation, *gbuffer, settings.denoiser);
+    }
+    frameUniforms->endFrame();
+}
+
+void Renderer::resolve(GLuint sourceTexture)
+{
+    // Resolve the accumulation into the sRGB target
+    ScopedGpuTimer timer(profiler, "resolve");
+    resolveTarget->begin();
+    quadShader.use();
+    quadShader.setFloat(exposureUniform, settings.exposure);
+    quadShader.setInt(tonemapOperatorUniform, settings.toneMapOperator);
+    glBindVertexArray(quadVAO);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, sourceTexture);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    resolveTarget->end();
+}
+
+void Renderer::present(int screenWidth, int screenHeight)
+{
+    ScopedGpuTimer timer(profiler, "present");
+    resolveTarget->blitToScreen(screenWidth, screenHeight);
+}
+
+size_t Renderer::getTextureMemory() const
+{
+    size_t bytesPerPixel = 2 * 16 + 2 * 8  // accumulation and moments pairs
+        + 2 * 16 + 8                        // G-buffer pair and current sample
+        + 4                                 // resolve target
+        + 2 * 8;                            // denoiser ping-pong
+    return size_t(width) * height * bytesPerPixel;
+}
+
+void Renderer::readResolved(std::vector<unsigned char>& rgba)
+{
+    // glGetTexImage returns the stored sRGB bytes without decoding them
+    rgba.resize(size_t(width) * height * 4);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glBindTexture(GL_TEXTURE_2D, resolveTarget->getTexture());
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+}
+
+void Renderer::averageSamples(const float* rgba, size_t pixelCount, std::vector<float>& rgb)
+{
+    rgb.resize(pixelCount * 3);
+    for (size_t i = 0; i < pixelCount; i++) {
+        float count = std::max(rgba[i * 4 + 3], 1.0f);
+        for (int k = 0; k < 3; k++) {
+            rgb[i * 3 + k] = rgba[i * 4 + k] / count;
+        }
+    }
+}
+
+void Renderer::readDisplay(std::vector<float>& rgb)
+{
+    readbackBarrier();
+    std::vector<float> rgba(size_t(width) * height * 4);
+    glBindTexture(GL_TEXTURE_2D, displayTexture);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, rgba.data());
+    averageSamples(rgba.data(), size_t(width) * height, rgb);
+}
+
+void Renderer::readAccumulation(std::vector<float>& rgba)
+{
+    readbackBarrier();
+    rgba.resize(size_t(width) * height * 4);
+    glBindTexture(GL_TEXTURE_2D, accumulation->resultTexture());
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, rgba.data());
+}
+
+// Inverse of the packing done by encode_gbuffer() in raytracer.cs
+static void decodeGBufferTexel(const GLuint texel[4], float normal[3], float& depth, float albedo[3])
+{
+    float e[2] = {
+        std::max(float(int16_t(texel[0] & 0xffff)) / 32767.0f, -1.0f),
+        std::max(float(int16_t(texel[0] >> 16)) / 32767.0f, -1.0f)
+    };
+    float n[3] = { e[0], e[1], 1.0f - std::abs(e[0]) - std::abs(e[1]) };
+    if (n[2] < 0.0f) {
+        float x = (1.0f - std::abs(n[1])) * (n[0] >= 0.0f ? 1.0f : -1.0f);
+        float y = (1.0f - std::abs(n[0])) * (n[1] >= 0.0f ? 1.0f : -1.0f);
+        n[0] = x;
+        n[1] = y;
+    }
+    float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    for (int k = 0; k < 3; k++) {
+        normal[k] = n[k] / length;
+        albedo[k] = float((texel[3] >> (8 * k)) & 0xff) / 255.0f;
+    }
+    std::memcpy(&depth, &texel[1], sizeof(float));
+}
+
+void Renderer::readAovs(CpuAovs& aovs)
+{
+    readbackBarrier();
+    size_t pixelCount = size_t(width) * height;
+    aovs.width = width;
+    aovs.height = height;
+
+    std::vector<float> rgba(pixelCount * 4);
+    glBindTexture(GL_TEXTURE_2D, accumulation->resultTexture());
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, rgba.data());
+
+    std::vector<GLuint> texels(pixelCount * 4);
+    glBindTexture(GL_TEXTURE_2D, gbuffer->resultTexture());
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA_INTEGER, GL_UNSIGNED_INT, texels.data());
+
+    averageSamples(rgba.data(), pixelCount, aovs.color);
+    aovs.albedo.resize(pixelCount * 3);
+    aovs.normal.resize(pixelCount * 3);
+    aovs.depth.resize(pixelCount);
+    for (size_t i = 0; i < pixelCount; i++) {
+        decodeGBufferTexel(&texels[i * 4], &aovs.normal[i * 3], aovs.depth[i], &aovs.albedo[i * 3]);
+    }
+}
@@ -0,0 +1,88 @@
+#include "ShaderPreprocessor.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+static std::filesystem::file_time_type writeTime(const std::string& path)
+{
+    std::error_code error;
+    std::filesystem::file_time_type time = std::filesystem::last_write_time(path, error);
+    return error ? std::filesystem::file_time_type::min() : time;
+}
+
+bool ShaderSource::changed() const
+{
+    for (size_t i = 0; i < files.size(); i++) {
+        if (writeTime(files[i]) != writeTimes[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string ShaderSource::describeFiles() const
+{
+    std::string text;
+    for (size_t i = 1; i < files.size(); i++) {
+        text += "source string " + std::to_string(i) + " is " + files[i] + "\n";
+    }
+    return text;
+}
+
+// name of an #include "name" line, empty for any other line
+static std::string includedName(const std::string& line)
+{
+    size_t start = line.find_first_not_of(" \t");
+    if (start == std::string::npos || line.compare(start, 8, "#include") != 0) {
+        return std::string();
+    }
+    size_t open = line.find('"', start + 8);
+    size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+    if (close == std::string::npos || close == open + 1) {
+        return std::string();
+    }
+    return line.substr(open + 1, close - open - 1);
+}
+
+static void appendFile(ShaderSource& source, const std::string& path)
+{
+    int index = (int)source.files.size();
+    source.files.push_back(path);
+    source.writeTimes.push_back(writeTime(path));
+
+    std::ifstream file(path);
+    if (!file) {
+        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+        source.code += "#error cannot read " + path + "\n";
+        return;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        std::string name = includedName(line);
+        if (name.empty()) {
+            source.code += line + "\n";
+            continue;
+        }
+
+        std::string included = RESOURCES_PATH + name;
+        if (std::find(source.files.begin(), source.files.end(), included) != source.files.end()) {
+            source.code += "\n";
+            continue;
+        }
+        source.code += "#line 1 " + std::to_string(source.files.size()) + "\n";
+        appendFile(source, included);
+        source.code += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(index) + "\n";
+    }
+}
+
+ShaderSource preprocessShader(const std::string& path)
+{
+    ShaderSource source;
+    appendFile(source, path);
+    return source;
+}
@@ -0,0 +1,113 @@
+#include "ShaderReflection.h"
+
+static uint32_t hashName(const char* name)
+{
+    uint32_t hash = 2166136261u;
+    for (; *name; name++) {
+        hash = (hash ^ (unsigned char)*name) * 16777619u;
+    }
+    return hash;
+}
+
+void ShaderReflection::NameTable::insert(const std::string& name, GLint value)
+{
+    // at most half full, so probes stay short and find() always reaches a free entry
+    if ((count + 1) * 2 > entries.size()) {
+        std::vector<Entry> old;
+        old.swap(entries);
+        entries.resize(old.empty() ? 16 : old.size() * 2);
+        count = 0;
+        for (Entry& entry : old) {
+            if (!entry.name.empty()) {
+                insert(entry.name, entry.value);
+            }
+        }
+    }
+
+    uint32_t hash = hashName(name.c_str());
+    size_t mask = entries.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        Entry& entry = entries[i];
+        if (entry.name.empty()) {
+            entry.hash = hash;
+            entry.value = value;
+            entry.name = name;
+            count++;
+            return;
+        }
+        if (entry.hash == hash && entry.name == name) {
+            entry.value = value;
+            return;
+        }
+    }
+}
+
+GLint ShaderReflection::NameTable::find(const char* name) const
+{
+    if (entries.empty()) {
+        return -1;
+    }
+    uint32_t hash = hashName(name);
+    size_t mask = entries.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        const Entry& entry = entries[i];
+        if (entry.name.empty()) {
+            return -1;
+        }
+        if (entry.hash == hash && entry.name == name) {
+            return entry.value;
+        }
+    }
+}
+
+void ShaderReflection::readResources(GLuint program, GLenum interface, GLenum property, NameTable& table)
+{
+    GLint count = 0, maxLength = 0;
+    glGetProgramInterfaceiv(program, interface, GL_ACTIVE_RESOURCES, &count);
+    glGetProgramInterfaceiv(program, interface, GL_MAX_NAME_LENGTH, &maxLength);
+    std::vector<char> name(maxLength + 1);
+    for (GLint i = 0; i < count; i++) {
+        GLint value = -1;
+        glGetProgramResourceiv(program, interface, i, 1, &property, 1, nullptr, &value);
+        if (value < 0) {
+            continue;   // a member of a uniform block
+        }
+        glGetProgramResourceName(program, interface, i, (GLsizei)name.size(), nullptr, name.data());
+        std::string resource = name.data();
+        table.insert(resource, value);
+        // arrays are listed as "name[0]", glGetUniformLocation also accepts plain "name"
+        if (resource.size() > 3 && resource.compare(resource.size() - 3, 3, "[0]") == 0) {
+            table.insert(resource.substr(0, resource.size() - 3), value);
+        }
+    }
+}
+
+void ShaderReflection::reflect(GLuint program)
+{
+    uniforms.clear();
+    uniformBlocks.clear();
+    storageBlocks.clear();
+    if (program) {
+        readResources(program, GL_UNIFORM, GL_LOCATION, uniforms);
+        readResources(program, GL_UNIFORM_BLOCK, GL_BUFFER_BINDING, uniformBlocks);
+        readResources(program, GL_SHADER_STORAGE_BLOCK, GL_BUFFER_BINDING, storageBlocks);
+    }
+    for (size_t i = 0; i < handleNames.size(); i++) {
+        handleLocations[i] = uniforms.find(handleNames[i].c_str());
+    }
+}
+
+UniformHandle ShaderReflection::handle(const char* name)
+{
+    UniformHandle handle;
+    for (size_t i = 0; i < handleNames.size(); i++) {
+        if (handleNames[i] == name) {
+            handle.slot = (int)i;
+            return handle;
+        }
+    }
+    handle.slot = (int)handleNames.size();
+    handleNames.push_back(name);
+    handleLocations.push_back(uniforms.find(name));
+    return handle;
+}
@@ -0,0 +1,182 @@
+#include "ShaderVariants.h"
+
+#include <chrono>
+#include <iostream>
+
+ShaderCompiler::ShaderCompiler(std::function<void()> makeCurrent, std::function<void()> release)
+    : makeCurrent(std::move(makeCurrent)), release(std::move(release))
+{
+    worker = std::thread(&ShaderCompiler::workerLoop, this);
+}
+
+ShaderCompiler::~ShaderCompiler()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        for (Job& job : jobs) {
+            job.program.set_value(0);
+        }
+        jobs.clear();
+    }
+    jobAvailable.notify_all();
+    worker.join();
+}
+
+std::future<GLuint> ShaderCompiler::compile(std::string source, std::string fileNames)
+{
+    Job job;
+    job.source = std::move(source);
+    job.fileNames = std::move(fileNames);
+    std::future<GLuint> program = job.program.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    jobAvailable.notify_one();
+    return program;
+}
+
+void ShaderCompiler::workerLoop()
+{
+    makeCurrent();
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            jobAvailable.wait(lock, [&] { return stopping || !jobs.empty(); });
+            if (jobs.empty()) {
+                break;
+            }
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+
+        GLuint program = ComputeShader::compileProgram(job.source, job.fileNames);
+        // the other context may only use the program once this one is done creating it
+        glFinish();
+        job.program.set_value(program);
+    }
+    release();
+}
+
+ShaderVariants::ShaderVariants(const char* path)
+    : path(path), source(preprocessShader(path))
+{
+}
+
+ShaderVariants::~ShaderVariants()
+{
+    for (auto& compiling : pending) {
+        retiredPending.push_back(std::move(compiling.second));
+    }
+    for (auto& variant : programs) {
+        retired.push_back(variant.second);
+    }
+    for (std::future<GLuint>& compiling : retiredPending) {
+        retired.push_back(compiling.get());
+    }
+    for (GLuint program : retired) {
+        if (program) {
+            glDeleteProgram(program);
+        }
+    }
+}
+
+std::string ShaderVariants::key(const ShaderDefines& defines)
+{
+    std::string text;
+    for (const auto& define : defines) {
+        text += define.first + "=" + define.second + ";";
+    }
+    return text;
+}
+
+GLuint ShaderVariants::get(const ShaderDefines& defines, ShaderCompiler* compiler)
+{
+    std::string name = key(defines);
+    auto variant = programs.find(name);
+    if (variant != programs.end()) {
+        return variant->second;
+    }
+
+    auto compiling = pending.find(name);
+    if (compiling == pending.end()) {
+        std::string variantSource = ComputeShader::injectDefines(source.code, defines);
+        if (!compiler) {
+            GLuint program = ComputeShader::compileProgram(variantSource, source.describeFiles());
+            programs[name] = program;
+            return program;
+        }
+        compiling = pending.emplace(name, compiler->compile(std::move(variantSource), source.describeFiles())).first;
+    }
+
+    if (compiling->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return 0;
+    }
+    GLuint program = compiling->second.get();
+    pending.erase(compiling);
+    programs[name] = program;
+    if (!program) {
+        std::cout << path << " does not compile with " << name << "\n";
+    }
+    return program;
+}
+
+GLuint ShaderVariants::select(const ShaderDefines& defines, ShaderCompiler* compiler)
+{
+    std::string name = key(defines);
+    if (selected && name == selectedKey && selectedGeneration == generation) {
+        return selected;
+    }
+    GLuint program = get(defines, compiler);
+    if (program) {
+        selected = program;
+        selectedKey = name;
+        selectedGeneration = generation;
+        releaseRetired();
+    }
+    return selected;
+}
+
+bool ShaderVariants::reload()
+{
+    if (!source.changed()) {
+        return false;
+    }
+    std::cout << "Reloading " << path << "\n";
+    source = preprocessShader(path);
+    generation++;
+    for (auto& variant : programs) {
+        if (variant.second) {
+            retired.push_back(variant.second);
+        }
+    }
+    programs.clear();
+    for (auto& compiling : pending) {
+        retiredPending.push_back(std::move(compiling.second));
+    }
+    pending.clear();
+    return true;
+}
+
+void ShaderVariants::releaseRetired()
+{
+    for (GLuint program : retired) {
+        glDeleteProgram(program);
+    }
+    retired.clear();
+    // compiles of an old generation are dropped as they finish
+    for (size_t i = 0; i < retiredPending.size();) {
+        if (retiredPending[i].wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            GLuint program = retiredPending[i].get();
+            if (program) {
+                glDeleteProgram(program);
+            }
+            retiredPending.erase(retiredPending.begin() + i);
+        }
+        else {
+            i++;
+        }
+    }
+}
@@ -0,0 +1,276 @@
+#include "Socket.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+
+typedef SOCKET NativeSocket;
+typedef int socklen_t;
+#define poll WSAPoll
+
+static bool startNetworking()
+{
+    static bool started = false;
+    if (!started) {
+        WSADATA data;
+        started = WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }
+    return started;
+}
+
+static void closeHandle(intptr_t handle) { closesocket((SOCKET)handle); }
+#else
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+typedef int NativeSocket;
+
+static bool startNetworking() { return true; }
+static void closeHandle(intptr_t handle) { ::close((int)handle); }
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+static const char UNIX_PREFIX[] = "unix:";
+
+static bool isUnixAddress(const std::string& address)
+{
+    return address.compare(0, sizeof(UNIX_PREFIX) - 1, UNIX_PREFIX) == 0;
+}
+
+// "host:port" or "port"
+static void splitAddress(const std::string& address, std::string& host, std::string& port)
+{
+    size_t colon = address.find_last_of(':');
+    if (colon == std::string::npos) {
+        host.clear();
+        port = address;
+    }
+    else {
+        host = address.substr(0, colon);
+        port = address.substr(colon + 1);
+    }
+}
+
+static void setNoDelay(intptr_t handle)
+{
+    // results go out in one large write, but the small job messages should not wait for Nagle
+    int one = 1;
+    setsockopt((NativeSocket)handle, IPPROTO_TCP, TCP_NODELAY, (const char*)&one, sizeof(one));
+}
+
+Socket::Socket(Socket&& other) noexcept
+    : handle(other.handle), unixPath(std::move(other.unixPath))
+{
+    other.handle = INVALID_HANDLE;
+    other.unixPath.clear();
+}
+
+Socket& Socket::operator=(Socket&& other) noexcept
+{
+    if (this != &other) {
+        close();
+        handle = other.handle;
+        unixPath = std::move(other.unixPath);
+        other.handle = INVALID_HANDLE;
+        other.unixPath.clear();
+    }
+    return *this;
+}
+
+void Socket::close()
+{
+    if (handle != INVALID_HANDLE) {
+        closeHandle(handle);
+        handle = INVALID_HANDLE;
+    }
+#ifndef _WIN32
+    if (!unixPath.empty()) {
+        unlink(unixPath.c_str());
+        unixPath.clear();
+    }
+#endif
+}
+
+Socket Socket::listen(const std::string& address)
+{
+    if (!startNetworking()) {
+        std::cout << "Failed to initialize networking\n";
+        return Socket();
+    }
+
+    if (isUnixAddress(address)) {
+#ifdef _WIN32
+        std::cout << "Unix domain sockets are not supported on this platform\n";
+        return Socket();
+#else
+        std::string path = address.substr(sizeof(UNIX_PREFIX) - 1);
+        sockaddr_un name = {};
+        name.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(name.sun_path)) {
+            std::cout << "Socket path too long: " << path << "\n";
+            return Socket();
+        }
+        std::strcpy(name.sun_path, path.c_str());
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        unlink(path.c_str());   // left over from a coordinator that did not shut down
+        if (fd < 0 || bind(fd, (sockaddr*)&name, sizeof(name)) != 0 || ::listen(fd, 16) != 0) {
+            std::cout << "Failed to listen on " << address << "\n";
+            if (fd >= 0) ::close(fd);
+            return Socket();
+        }
+        Socket result(fd);
+        result.unixPath = path;
+        return result;
+#endif
+    }
+
+    std::string host, port;
+    splitAddress(address, host, port);
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo* addresses = nullptr;
+    if (getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &addresses) != 0) {
+        std::cout << "Failed to resolve " << address << "\n";
+        return Socket();
+    }
+
+    Socket result;
+    for (addrinfo* a = addresses; a && !result.valid(); a = a->ai_next) {
+        auto fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if ((intptr_t)fd == INVALID_HANDLE) continue;
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (const char*)&one, sizeof(one));
+        if (bind(fd, a->ai_addr, (socklen_t)a->ai_addrlen) == 0 && ::listen(fd, 16) == 0) {
+            result = Socket((intptr_t)fd);
+        }
+        else {
+            closeHandle((intptr_t)fd);
+        }
+    }
+    freeaddrinfo(addresses);
+
+    if (!result.valid()) {
+        std::cout << "Failed to listen on " << address << "\n";
+    }
+    return result;
+}
+
+Socket Socket::connect(const std::string& address)
+{
+    if (!startNetworking()) {
+        std::cout << "Failed to initialize networking\n";
+        return Socket();
+    }
+
+    if (isUnixAddress(address)) {
+#ifdef _WIN32
+        std::cout << "Unix domain sockets are not supported on this platform\n";
+        return Socket();
+#else
+        std::string path = address.substr(sizeof(UNIX_PREFIX) - 1);
+        sockaddr_un name = {};
+        name.sun_family = AF_UNIX;
+        std::strncpy(name.sun_path, path.c_str(), sizeof(name.sun_path) - 1);
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 || ::connect(fd, (sockaddr*)&name, sizeof(name)) != 0) {
+            if (fd >= 0) ::close(fd);
+            return Socket();
+        }
+        return Socket(fd);
+#endif
+    }
+
+    std::string host, port;
+    splitAddress(address, host, port);
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses = nullptr;
+    if (getaddrinfo(host.empty() ? "localhost" : host.c_str(), port.c_str(), &hints, &addresses) != 0) {
+        std::cout << "Failed to resolve " << address << "\n";
+        return Socket();
+    }
+
+    Socket result;
+    for (addrinfo* a = addresses; a && !result.valid(); a = a->ai_next) {
+        auto fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if ((intptr_t)fd == INVALID_HANDLE) continue;
+        if (::connect(fd, a->ai_addr, (socklen_t)a->ai_addrlen) == 0) {
+            result = Socket((intptr_t)fd);
+            setNoDelay(result.handle);
+        }
+        else {
+            closeHandle((intptr_t)fd);
+        }
+    }
+    freeaddrinfo(addresses);
+    return result;
+}
+
+Socket Socket::accept(int timeoutMs)
+{
+    pollfd request = {};
+    request.fd = (NativeSocket)handle;
+    request.events = POLLIN;
+    if (poll(&request, 1, timeoutMs) <= 0 || !(request.revents & POLLIN)) {
+        return Socket();
+    }
+
+    auto fd = ::accept(request.fd, nullptr, nullptr);
+    if ((intptr_t)fd == INVALID_HANDLE) {
+        return Socket();
+    }
+    Socket result((intptr_t)fd);
+    if (unixPath.empty()) {
+        setNoDelay(result.handle);
+    }
+    return result;
+}
+
+bool Socket::sendAll(const void* data, size_t size)
+{
+    const char* bytes = (const char*)data;
+    while (size > 0) {
+        int chunk = (int)std::min<size_t>(size, 1 << 30);
+        auto sent = send((NativeSocket)handle, bytes, chunk, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            return false;
+        }
+        bytes += sent;
+        size -= (size_t)sent;
+    }
+    return true;
+}
+
+bool Socket::receiveAll(void* data, size_t size)
+{
+    char* bytes = (char*)data;
+    while (size > 0) {
+        int chunk = (int)std::min<size_t>(size, 1 << 30);
+        auto received = recv((NativeSocket)handle, bytes, chunk, 0);
+        if (received <= 0) {
+            return false;
+        }
+        bytes += received;
+        size -= (size_t)received;
+    }
+    return true;
+}
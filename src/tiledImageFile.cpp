@@ -0,0 +1,138 @@
+#include "TiledImageFile.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "ImageIO.h"
+
+static bool endsWith(const std::string& text, const char* suffix)
+{
+    size_t length = std::strlen(suffix);
+    return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+}
+
+bool TiledImageFile::seek(uint64_t offset)
+{
+    // the files easily go past 2 GB at print resolutions
+#ifdef _WIN32
+    return _fseeki64(file, (__int64)offset, SEEK_SET) == 0;
+#else
+    return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+bool TiledImageFile::open(const std::string& path, int width, int height)
+{
+    close();
+
+    if (endsWith(path, ".ppm")) format = FORMAT_PPM;
+    else if (endsWith(path, ".pfm")) format = FORMAT_PFM;
+    else if (endsWith(path, ".exr")) format = FORMAT_EXR;
+    else {
+        std::cout << "Tiled output has to be .ppm, .pfm or .exr: " << path << "\n";
+        return false;
+    }
+
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cout << "Failed to open " << path << " for writing\n";
+        return false;
+    }
+    this->path = path;
+    this->width = width;
+    this->height = height;
+    failed = false;
+
+    if (format == FORMAT_PPM) {
+        std::fprintf(file, "P6\n%d %d\n255\n", width, height);
+        dataOffset = (uint64_t)std::ftell(file);
+    }
+    else if (format == FORMAT_PFM) {
+        std::fprintf(file, "PF\n%d %d\n-1.0\n", width, height);
+        dataOffset = (uint64_t)std::ftell(file);
+    }
+    else {
+        // Every scanline is its own uncompressed block, so the offset table and the block
+        // headers are known up front and tiles only fill in the pixel data
+        std::vector<unsigned char> header = exrHeader(width, height, EXR_NO_COMPRESSION);
+        uint64_t lineSize = uint64_t(width) * 3 * sizeof(uint16_t);
+        dataOffset = header.size() + sizeof(uint64_t) * height;
+        failed = std::fwrite(header.data(), 1, header.size(), file) != header.size();
+        for (int line = 0; line < height && !failed; line++) {
+            uint64_t offset = dataOffset + line * (8 + lineSize);
+            failed = std::fwrite(&offset, sizeof(offset), 1, file) != 1;
+        }
+        for (int line = 0; line < height && !failed; line++) {
+            int32_t blockHeader[2] = { line, (int32_t)lineSize };
+            failed = !seek(dataOffset + line * (8 + lineSize)) || std::fwrite(blockHeader, sizeof(blockHeader), 1, file) != 1;
+        }
+    }
+    return !failed;
+}
+
+bool TiledImageFile::close()
+{
+    if (!file) {
+        return true;
+    }
+
+    bool ok = std::fclose(file) == 0 && !failed;
+    if (!ok) {
+        std::cout << "Failed to write " << path << "\n";
+    }
+    file = nullptr;
+    return ok;
+}
+
+bool TiledImageFile::writeTile(int x, int y, int tileWidth, int tileHeight, int stride, const unsigned char* rgba)
+{
+    if (!file || format != FORMAT_PPM) {
+        return false;
+    }
+
+    std::vector<unsigned char> row(size_t(tileWidth) * 3);
+    for (int r = 0; r < tileHeight && !failed; r++) {
+        const unsigned char* src = rgba + size_t(r) * stride * 4;
+        for (int i = 0; i < tileWidth; i++) {
+            std::memcpy(&row[i * 3], &src[i * 4], 3);
+        }
+        // PPM rows go top to bottom
+        uint64_t line = uint64_t(height - 1 - (y + r));
+        failed = !seek(dataOffset + (line * width + x) * 3) || std::fwrite(row.data(), 1, row.size(), file) != row.size();
+    }
+    return !failed;
+}
+
+bool TiledImageFile::writeTile(int x, int y, int tileWidth, int tileHeight, int stride, const float* rgb)
+{
+    if (!file || format == FORMAT_PPM) {
+        return false;
+    }
+
+    std::vector<uint16_t> channel(tileWidth);
+    for (int r = 0; r < tileHeight && !failed; r++) {
+        const float* src = rgb + size_t(r) * stride * 3;
+        if (format == FORMAT_PFM) {
+            // PFM rows go bottom to top, like ours
+            uint64_t line = uint64_t(y + r);
+            failed = !seek(dataOffset + (line * width + x) * 12) || std::fwrite(src, sizeof(float) * 3, tileWidth, file) != (size_t)tileWidth;
+            continue;
+        }
+
+        // EXR lines go top to bottom, each one holds all B, then G, then R values
+        uint64_t line = uint64_t(height - 1 - (y + r));
+        uint64_t lineSize = uint64_t(width) * 3 * sizeof(uint16_t);
+        uint64_t block = dataOffset + line * (8 + lineSize) + 8;
+        for (int c = 0; c < 3 && !failed; c++) {
+            for (int i = 0; i < tileWidth; i++) {
+                channel[i] = (uint16_t)glm::packHalf1x16(src[i * 3 + (2 - c)]);
+            }
+            uint64_t offset = block + (uint64_t(c) * width + x) * sizeof(uint16_t);
+            failed = !seek(offset) || std::fwrite(channel.data(), sizeof(uint16_t), tileWidth, file) != (size_t)tileWidth;
+        }
+    }
+    return !failed;
+}
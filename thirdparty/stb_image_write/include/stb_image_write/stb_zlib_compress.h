@@ -0,0 +1,17 @@
+#ifndef STB_ZLIB_COMPRESS_H
+#define STB_ZLIB_COMPRESS_H
+
+// The zlib encoder behind stb_image_write's PNG writer, which stb_image_write.h defines but
+// does not declare. This matches the copy vendored next to it, v1.02 (2016-04-02), where it is
+// an extern function and the result is released with free() (STBIW_FREE).
+//
+// Check the definition when updating stb_image_write: later releases mark it STBIWDEF, so it
+// is static under STB_IMAGE_WRITE_STATIC, and leave it out when STBIW_ZLIB_COMPRESS is set.
+// src/stb_image_write.cpp fails to compile if the signature below stops matching.
+#if defined(STB_IMAGE_WRITE_STATIC) || defined(STBIW_ZLIB_COMPRESS)
+#error "stbi_zlib_compress is not exported by this stb_image_write configuration"
+#endif
+
+unsigned char* stbi_zlib_compress(unsigned char* data, int data_len, int* out_len, int quality);
+
+#endif
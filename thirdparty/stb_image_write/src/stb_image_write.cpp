@@ -0,0 +1,9 @@
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write/stb_image_write.h>
+#include <stb_image_write/stb_zlib_compress.h>
+
+#include <type_traits>
+
+// a second overload here means the declaration no longer matches the definition
+static_assert(std::is_same<decltype(&stbi_zlib_compress), unsigned char* (*)(unsigned char*, int, int*, int)>::value,
+    "stb_zlib_compress.h does not match the vendored stb_image_write.h");